@@ -5,7 +5,7 @@ module JSOS
     def initialize(ast, filename = "")
       @ast = ast
       @sections = [[]]
-      @section_flags = [{ var_count: 0, flags: 0 }]
+      @section_flags = [{ var_count: 0, local_count: 0, flags: 0, exception_ranges: [] }]
       @section_stack = [0]
       @scope_stack = []
       @interned_strings = {}
@@ -26,6 +26,9 @@ module JSOS
     SECTION_FLAGS = {
       has_inner_funcs: 1
     }
+    
+    # marks a variable operand to setcallee, setarg, arguments or catch as a stack local
+    VAR_LOCAL = 0x80000000
   
     OPCODES = {
       undefined:  0,
@@ -99,6 +102,10 @@ module JSOS
       jend:       68,
       enumpop:    69,
       eq:         70,
+      pushlocal:  71,
+      setlocal:   72,
+      arglen:     73,
+      argindex:   74,
     }
 
   private
@@ -108,10 +115,17 @@ module JSOS
       bytecode << [intern_string(@filename)].pack("L<")
       # how many sections exist as LE uint32_t:
       bytecode << [@sections.size].pack("L<")
-      @sections.map(&method(:generate_bytecode_for_section)).each_with_index do |sect, idx|
+      @sections.each_with_index do |section, idx|
+        labels = label_offsets(section)
+        sect = generate_bytecode_for_section(section, labels)
         bytecode << [sect.size].pack("L<")
         bytecode << [@section_flags[idx][:flags]].pack("L<")
         bytecode << [@section_flags[idx][:var_count]].pack("L<")
+        bytecode << [@section_flags[idx][:local_count]].pack("L<")
+        bytecode << [@section_flags[idx][:exception_ranges].size].pack("L<")
+        @section_flags[idx][:exception_ranges].each do |range|
+          bytecode << range.map { |label| labels[label] }.pack("L<*")
+        end
         bytecode << sect
       end
       bytecode << [@interned_strings.count].pack("L<")
@@ -122,7 +136,7 @@ module JSOS
       end
     end
   
-    def generate_bytecode_for_section(section)
+    def label_offsets(section)
       acc = 0
       label_refs = {}
       section.each do |sect|
@@ -136,6 +150,10 @@ module JSOS
           acc += sect.bytes.count
         end
       end
+      label_refs
+    end
+  
+    def generate_bytecode_for_section(section, label_refs)
       section.reject { |a,b| a == :label }.map { |x| x.is_a?(Array) ? [label_refs[x[1]]].pack("L<") : x }.join
     end
 
@@ -151,7 +169,7 @@ module JSOS
       unless section
         @section_stack << @sections.size
         @sections << []
-        @section_flags << { var_count: 0, flags: 0 }
+        @section_flags << { var_count: 0, local_count: 0, flags: 0, exception_ranges: [] }
       else
         @section_stack << section
       end  
@@ -162,8 +180,10 @@ module JSOS
       @section_stack.pop
     end
   
-    def push_scope
-      @scope_stack << { }
+    # captured is the set of names that inner functions might refer to. only those
+    # variables go in the scope, which closures keep alive - the rest live on the stack
+    def push_scope(captured = {}, lazy_arguments = false)
+      @scope_stack << { vars: {}, captured: captured, lazy_arguments: lazy_arguments }
     end
   
     def pop_scope
@@ -174,22 +194,120 @@ module JSOS
       @scope_stack.last
     end
   
+    # returns the variable as an operand for setcallee, setarg, arguments or catch
     def create_local_var(var)
-      if @scope_stack.any?
-        @scope_stack.last[var] ||= @scope_stack.last.count
-        if @scope_stack.last[var] >= current_section_flags[:var_count]
-          current_section_flags[:var_count] = @scope_stack.last[var] + 1
+      if scope = @scope_stack.last
+        scope[:vars][var] ||= if scope[:captured][var]
+          [:var, (current_section_flags[:var_count] += 1) - 1]
+        else
+          [:local, (current_section_flags[:local_count] += 1) - 1]
         end
-        @scope_stack.last[var]
+        kind, idx = scope[:vars][var]
+        kind == :local ? idx | VAR_LOCAL : idx
       end
     end
   
+    # returns [kind, index, scopes up], or nil for globals
     def lookup_var(var)
       @scope_stack.reverse_each.each_with_index do |scope, index|
-        return [scope[var], index] if scope[var]
+        if found = scope[:vars][var]
+          kind, idx = found
+          if kind == :local && index > 0
+            raise "'#{var}' is used by an inner function but was kept on the stack"
+          end
+          return [kind, idx, index]
+        end
       end
       nil
     end
+    
+    def output_pushvar(var)
+      kind, idx, sc = lookup_var var
+      case kind
+      when :local;  output :pushlocal, idx
+      when :var;    output :pushvar, idx, sc
+      else          output :pushglobal, var
+      end
+    end
+    
+    def output_setvar(var)
+      kind, idx, sc = lookup_var var
+      case kind
+      when :local;  output :setlocal, idx
+      when :var;    output :setvar, idx, sc
+      else          output :setglobal, var
+      end
+    end
+    
+    # every name mentioned anywhere inside functions nested in node. this doesn't bother
+    # with shadowing, so might keep a variable in the scope that needn't be
+    def captured_vars(node)
+      captured = {}
+      node.statements.each do |statement|
+        statement.walk do |n|
+          if n.is_a? Twostroke::AST::Function
+            n.walk do |inner|
+              if inner.is_a?(Twostroke::AST::Variable) || inner.is_a?(Twostroke::AST::Declaration)
+                captured[inner.name] = true
+              end
+              true
+            end
+            false
+          else
+            true
+          end
+        end
+      end
+      captured
+    end
+    
+    # true if the function only ever reads arguments.length and arguments[i], which the
+    # vm can answer straight from the call without making an arguments object
+    def lazy_arguments?(node)
+      return false if node.arguments.include? "arguments"
+      used = false
+      lazy = true
+      targets = {}
+      readable = {}
+      node.statements.each do |statement|
+        statement.walk do |n|
+          case n
+          when Twostroke::AST::Function
+            next false
+          when Twostroke::AST::Declaration
+            lazy = false if n.name == "arguments"
+          when Twostroke::AST::Assignment
+            targets[n.left.object_id] = true
+          when Twostroke::AST::PostIncrement, Twostroke::AST::PostDecrement,
+               Twostroke::AST::PreIncrement, Twostroke::AST::PreDecrement, Twostroke::AST::Delete
+            targets[n.value.object_id] = true
+          when Twostroke::AST::ForIn
+            targets[n.lval.object_id] = true
+          when Twostroke::AST::Call
+            # arguments[i]() would be called with arguments as this
+            targets[n.callee.object_id] = true
+          when Twostroke::AST::MemberAccess
+            if n.member.to_s == "length" && !targets[n.object_id]
+              readable[n.object.object_id] = true
+            end
+          when Twostroke::AST::Index
+            readable[n.object.object_id] = true unless targets[n.object_id]
+          when Twostroke::AST::Variable
+            if n.name == "arguments"
+              used = true
+              lazy = false unless readable[n.object_id]
+            end
+          end
+          targets[n.left.object_id] = true if n.respond_to?(:assign_result_left) && n.assign_result_left
+          true
+        end
+      end
+      used && lazy
+    end
+    
+    def arguments_object?(node)
+      node.is_a?(Twostroke::AST::Variable) && node.name == "arguments" && current_scope && current_scope[:lazy_arguments]
+    end
 
     def compile_node(node)
       if @current_line != node.line
@@ -238,7 +356,7 @@ module JSOS
           create_local_var node.name
         elsif node.is_a? Twostroke::AST::Variable
           if node.name == "arguments"
-            next if seen_arguments
+            next if seen_arguments || arguments_object?(node)
             seen_arguments = true
             output :arguments, create_local_var("arguments")
           end
@@ -275,12 +393,7 @@ module JSOS
             compile_node node.left
             compile_node node.right
             output op
-            idx, sc = lookup_var node.left.name
-            if idx
-              output :setvar, idx, sc
-            else
-              output :setglobal, node.left.name
-            end
+            output_setvar node.left.name
           elsif type(node.left) == :MemberAccess
             compile_node node.left.object
             output :dup
@@ -329,18 +442,10 @@ module JSOS
   
     def post_mutate(left)
       if type(left) == :Variable || type(left) == :Declaration
-        if var = lookup_var(left.name)
-          output :pushvar, *var
-        else
-          output :pushglobal, left.name
-        end
+        output_pushvar left.name
         output :dup
         yield
-        if var
-          output :setvar, *var
-        else
-          output :setglobal, left.name
-        end
+        output_setvar left.name
         output :pop
       elsif type(left) == :MemberAccess
         compile_node left.object
@@ -384,17 +489,9 @@ module JSOS
     
     def pre_mutate(left)
       if type(left) == :Variable || type(left) == :Declaration
-        if var = lookup_var(left.name)
-          output :pushvar, *var
-        else
-          output :pushglobal, left.name
-        end
+        output_pushvar left.name
         yield
-        if var
-          output :setvar, *var
-        else
-          output :setglobal, left.name
-        end
+        output_setvar left.name
       elsif type(left) == :MemberAccess
         compile_node left.object
         output :dup
@@ -436,7 +533,7 @@ module JSOS
         else
           node.fnid = fnid = push_section
         end
-        push_scope
+        push_scope captured_vars(node), lazy_arguments?(node)
         output :setcallee, create_local_var(node.name) if node.name
         node.arguments.each_with_index do |arg, idx|
           output :setarg, create_local_var(arg), idx
@@ -454,11 +551,8 @@ module JSOS
           output :close, fnid
         end
         if node.name && !node.as_expression
-          if idx = create_local_var(node.name)
-            output :setvar, create_local_var(node.name), 0 
-          else
-            output :setglobal, node.name
-          end
+          create_local_var node.name
+          output_setvar node.name
         end
       else
         if node.name
@@ -481,12 +575,7 @@ module JSOS
     end
   
     def Variable(node)
-      idx, sc = lookup_var node.name
-      if idx
-        output :pushvar, idx, sc
-      else
-        output :pushglobal, node.name
-      end
+      output_pushvar node.name
     end
   
     def Number(node)
@@ -513,11 +602,20 @@ module JSOS
     end
   
     def MemberAccess(node)
+      if arguments_object?(node.object) && node.member.to_s == "length"
+        output :arglen
+        return
+      end
       compile_node node.object
       output :member, node.member
     end
   
     def Index(node)
+      if arguments_object?(node.object)
+        compile_node node.index
+        output :argindex
+        return
+      end
       compile_node node.object
       compile_node node.index
       output :index
@@ -579,12 +677,7 @@ module JSOS
     def Assignment(node)
       if type(node.left) == :Variable || type(node.left) == :Declaration
         compile_node node.right
-        idx, sc = lookup_var node.left.name
-        if idx
-          output :setvar, idx, sc
-        else
-          output :setglobal, node.left.name
-        end
+        output_setvar node.left.name
         output :pop if type(node.left) == :Declaration
       elsif type(node.left) == :MemberAccess
         compile_node node.left.object
@@ -710,12 +803,7 @@ module JSOS
       case node.lval
       when Twostroke::AST::Declaration, Twostroke::AST::Variable
         output :enumnext
-        idx, sc = lookup_var node.lval.name
-        if idx
-          output :setvar, idx, sc
-        else
-          output :setglobal, node.lval.name
-        end
+        output_setvar node.lval.name
       when Twostroke::AST::MemberAccess
         compile_node node.lval
         output :enumnext
@@ -734,12 +822,17 @@ module JSOS
       @continue_stack.pop
     end
     
+    # entering a try costs nothing: the vm looks up the section's exception ranges
+    # when something is thrown or returned, so the blocks only need labelling here
     def Try(node)
+      try_label = uniqid
+      try_end_label = uniqid
       catch_label = uniqid
       finally_label = uniqid
-      output :try, [:ref, catch_label], [:ref, finally_label]
+      output [:label, try_label]
       node.try_statements.each { |n| compile_node n }
-      output :poptry
+      output [:label, try_end_label]
+      output :jmp, [:ref, finally_label]
 
       output [:label, catch_label]
       if node.catch_statements
@@ -749,13 +842,17 @@ module JSOS
           output :catchg, node.catch_variable
         end
         node.catch_statements.each { |n| compile_node n }
-        output :popcatch
       end
 
       output [:label, finally_label]
       output :finally
       node.finally_statements.each { |n| compile_node n } if node.finally_statements
       output :popfinally
+
+      # nested trys have already added theirs, which keeps the ranges innermost first:
+      ranges = current_section_flags[:exception_ranges]
+      ranges << [try_label, try_end_label, catch_label, finally_label]
+      ranges << [catch_label, finally_label, finally_label, finally_label] if node.catch_statements
     end
     
     def Break(node)
@@ -8,4 +8,6 @@ void lib_kernel_init(js_vm_t* vm);
 void lib_binary_utils_init(js_vm_t* vm);
 void lib_buffer_init(js_vm_t* vm);
 
+void kernel_dispatch_memory_pressure();
+
 #endif
\ No newline at end of file
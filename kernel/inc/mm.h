@@ -11,6 +11,7 @@
 
 void mm_init(multiboot_memory_map_t* mmap, uint32_t length, uint32_t highest_module);
 void* sbrk(int32_t increment);
+uint32_t mm_heap_size();
 
 void paging_set_directory(void* page_directory);
 
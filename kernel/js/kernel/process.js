@@ -6,9 +6,12 @@ Process = (function() {
     function Process(opts) {
         opts = opts || {};
         this._vm = new VM();
+        if(opts.memoryLimit) {
+            this._vm.memoryLimit = opts.memoryLimit;
+        }
         this._running = true;
         this.id = pidIncrement++;
-        Process.processes[this.id] = this;
+        Process.processes.set(this.id, this);
         this.fds = {};
         this.parent = opts.parent || null;
         this.argv = opts.argv || [];
@@ -45,8 +48,9 @@ Process = (function() {
             }
         }
         if(this.waiters.length) {
-            delete Process.processes[this.id];
+            Process.processes["delete"](this.id);
         }
+        this._vm.destroy();
     };
 
     Process.prototype.loadImage = function(image) {
@@ -339,7 +343,7 @@ Process = (function() {
             if(self.id === pid) {
                 throw self.createSystemError("cannot wait on self");
             }
-            var proc = Process.processes[pid];
+            var proc = Process.processes.get(pid);
             if(!proc) {
                 throw self.createSystemError("no such process: " + pid);
             }
@@ -348,7 +352,7 @@ Process = (function() {
                 proc.waiters.push({ process: self, callback: callback });
             } else {
                 self.enqueueCallback(callback, [proc.exitStatus]);
-                delete Process.processes[pid];
+                Process.processes["delete"](pid);
             }
         });
         
@@ -410,7 +414,8 @@ Process = (function() {
         return this._vm.safeCall(callback, args || []);
     };
     
-    Process.processes = {};
+    // "delete" is a keyword to the compiler, hence Process.processes["delete"](pid)
+    Process.processes = new Map();
     Process.alarms = new LinkedList();
     
     Process.scheduleNext = function() {
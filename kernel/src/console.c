@@ -31,7 +31,8 @@ static VAL Console_cursor(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL
         yx[1] = js_value_make_double(col);
         return js_make_array(vm, 2, yx);
     }
-    js_scan_args(vm, argc, argv, "II", &r, &c);
+    r = js_arg_uint32(vm, argc, argv, 0);
+    c = js_arg_uint32(vm, argc, argv, 1);
     if(r >= height) {
         row = height - 1;
     }
@@ -51,7 +52,8 @@ static VAL Console_size(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL*
         wh[1] = js_value_make_double(height);
         return js_make_array(vm, 2, wh);
     } else {
-        js_scan_args(vm, argc, argv, "II", &w, &h);
+        w = js_arg_uint32(vm, argc, argv, 0);
+        h = js_arg_uint32(vm, argc, argv, 1);
         width = w;
         height = h;
         return js_value_undefined();
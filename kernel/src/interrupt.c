@@ -5,6 +5,7 @@
 #include "io.h"
 #include "console.h"
 #include "panic.h"
+#include "lib.h"
 
 static idtr_t idtr;
 static idt_entry_t* idt = (idt_entry_t*)0x70000;
@@ -110,15 +111,13 @@ void interrupt_dispatch_events()
         uint32_t error = queued_interrupts[queue_front].error;
         queue_front = (queue_front + 1) % MAX_QUEUED_INTERRUPTS;
         
-        char buff[8];
-        itoa(interrupt, buff, 10);
-        VAL isr = js_object_get(js_isr_table, js_cstring(buff));
+        VAL isr = js_object_get_index(js_isr_table, interrupt);
         VAL errcode = js_value_make_double(error);
         if(js_value_get_type(isr) == JS_T_FUNCTION) {
             js_call(isr, js_isr_table, 1, &errcode);
         }
     }
-    VAL isr = js_object_get(js_isr_table, js_cstring("32"));
+    VAL isr = js_object_get_index(js_isr_table, 32);
     VAL errcode = js_value_make_double(0);
     if(js_value_get_type(isr) == JS_T_FUNCTION) {
         while(pit_interrupt_count > 0) {
@@ -133,6 +132,7 @@ void interrupt_dispatch_events()
 static VAL Kernel_dispatch_interrupts(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     interrupt_dispatch_events();
+    kernel_dispatch_memory_pressure();
     return js_value_undefined();
 }
 
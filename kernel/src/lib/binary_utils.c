@@ -9,7 +9,8 @@ static VAL BinaryUtils_readU64(js_vm_t* vm, void* state, VAL this, uint32_t argc
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 8 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
@@ -22,7 +23,8 @@ static VAL BinaryUtils_readS64(js_vm_t* vm, void* state, VAL this, uint32_t argc
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 8 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
@@ -35,7 +37,8 @@ static VAL BinaryUtils_readU32(js_vm_t* vm, void* state, VAL this, uint32_t argc
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 4 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
@@ -48,7 +51,8 @@ static VAL BinaryUtils_readS32(js_vm_t* vm, void* state, VAL this, uint32_t argc
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 4 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
@@ -61,7 +65,8 @@ static VAL BinaryUtils_readU16(js_vm_t* vm, void* state, VAL this, uint32_t argc
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 2 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
@@ -74,7 +79,8 @@ static VAL BinaryUtils_readS16(js_vm_t* vm, void* state, VAL this, uint32_t argc
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 2 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
@@ -88,7 +94,8 @@ static VAL BinaryUtils_readU8(js_vm_t* vm, void* state, VAL this, uint32_t argc,
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 1 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
@@ -101,7 +108,8 @@ static VAL BinaryUtils_readS8(js_vm_t* vm, void* state, VAL this, uint32_t argc,
 {
     VAL buff;
     uint32_t offset;
-    js_scan_args(vm, argc, argv, "SI", &buff, &offset);
+    buff = js_arg_string(vm, argc, argv, 0);
+    offset = js_arg_uint32(vm, argc, argv, 1);
     js_string_t* str = &js_value_get_pointer(buff)->string;
     if(offset + 1 > str->length) {
         js_throw_error(vm->lib.RangeError, "tried to read past end of buffer of length %d (offset was %d)", str->length, offset);
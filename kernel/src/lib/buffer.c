@@ -30,7 +30,7 @@ static VAL Buffer_construct(js_vm_t* vm, void* state, VAL this, uint32_t argc, V
     if(argc > 0 && js_value_get_type(argv[0]) == JS_T_NUMBER) {
         buffer->capacity = js_to_uint32(argv[0]);
     }
-    buffer->buffer = js_alloc_no_pointer(buffer->capacity);
+    buffer->buffer = js_alloc_movable(buffer->capacity, &buffer->buffer);
     buffer->size = 0;
     js_value_get_pointer(this)->object.state = buffer;
     return js_value_undefined();
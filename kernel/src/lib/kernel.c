@@ -3,10 +3,12 @@
 #include <gc.h>
 #include <exception.h>
 #include <string.h>
+#include <stdlib.h>
 #include <jit.h>
 #include "panic.h"
 #include "console.h"
 #include "lib.h"
+#include "mm.h"
 
 static VAL Kernel;
 
@@ -32,9 +34,265 @@ static VAL Kernel_memory_usage(js_vm_t* vm, void* state, VAL this, uint32_t argc
 static VAL Kernel_run_gc(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     js_gc_run();
+    js_gc_finish_sweep();
     return js_value_undefined();
 }
 
+static VAL Kernel_compact_heap(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_gc_compact();
+    return js_value_undefined();
+}
+
+extern void malloc_free_space(size_t* total, size_t* largest);
+
+#define GC_STATS_SITES 20
+
+static VAL Kernel_gc_stats(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    VAL obj = js_make_object(vm);
+    VAL histogram[JS_GC_PAUSE_BUCKETS];
+    VAL slabs[JS_GC_SLAB_CLASSES];
+    js_gc_stats_t stats;
+    size_t heap_free, heap_largest_free;
+    uint32_t heap_fragmentation = 0;
+    uint32_t i;
+    js_gc_get_stats(&stats);
+    malloc_free_space(&heap_free, &heap_largest_free);
+    if(heap_free >= 100 && heap_largest_free / (heap_free / 100) < 100) {
+        heap_fragmentation = 100 - heap_largest_free / (heap_free / 100);
+    }
+    for(i = 0; i < JS_GC_PAUSE_BUCKETS; i++) {
+        histogram[i] = js_value_make_double(stats.pause_histogram[i]);
+    }
+    for(i = 0; i < JS_GC_SLAB_CLASSES; i++) {
+        slabs[i] = js_make_object(vm);
+        js_object_put(slabs[i], js_cstring("objectSize"), js_value_make_double(stats.slabs[i].object_size));
+        js_object_put(slabs[i], js_cstring("slabs"), js_value_make_double(stats.slabs[i].slabs));
+        js_object_put(slabs[i], js_cstring("used"), js_value_make_double(stats.slabs[i].used));
+        js_object_put(slabs[i], js_cstring("capacity"), js_value_make_double(stats.slabs[i].capacity));
+    }
+    js_object_put(obj, js_cstring("memoryUsage"), js_value_make_double(js_gc_memory_usage()));
+    js_object_put(obj, js_cstring("collections"), js_value_make_double(stats.collections));
+    js_object_put(obj, js_cstring("lastPause"), js_value_make_double(stats.last_pause));
+    js_object_put(obj, js_cstring("maxPause"), js_value_make_double(stats.max_pause));
+    js_object_put(obj, js_cstring("totalPause"), js_value_make_double(stats.total_pause));
+    js_object_put(obj, js_cstring("pauseHistogram"), js_make_array(vm, JS_GC_PAUSE_BUCKETS, histogram));
+    js_object_put(obj, js_cstring("markedBytes"), js_value_make_double(stats.marked_bytes));
+    js_object_put(obj, js_cstring("sweptBytes"), js_value_make_double(stats.swept_bytes));
+    js_object_put(obj, js_cstring("allocatedBytes"), js_value_make_double(stats.allocated_bytes));
+    js_object_put(obj, js_cstring("smallUsage"), js_value_make_double(stats.small_usage));
+    js_object_put(obj, js_cstring("largeUsage"), js_value_make_double(stats.large_usage));
+    js_object_put(obj, js_cstring("movableUsage"), js_value_make_double(stats.movable_usage));
+    js_object_put(obj, js_cstring("largeObjects"), js_value_make_double(stats.large_objects));
+    js_object_put(obj, js_cstring("largeReserved"), js_value_make_double(stats.large_reserved));
+    js_object_put(obj, js_cstring("movableChunks"), js_value_make_double(stats.movable_chunks));
+    js_object_put(obj, js_cstring("movableSize"), js_value_make_double(stats.movable_size));
+    js_object_put(obj, js_cstring("movableLive"), js_value_make_double(stats.movable_live));
+    js_object_put(obj, js_cstring("movableFragmentation"), js_value_make_double(stats.movable_fragmentation));
+    js_object_put(obj, js_cstring("slabs"), js_make_array(vm, JS_GC_SLAB_CLASSES, slabs));
+    js_object_put(obj, js_cstring("compactions"), js_value_make_double(stats.compactions));
+    js_object_put(obj, js_cstring("pinnedChunks"), js_value_make_double(stats.pinned_chunks));
+    js_object_put(obj, js_cstring("bytesEvacuated"), js_value_make_double(stats.bytes_evacuated));
+    // heap fragmentation is how much of the free space can't be handed out in one piece:
+    js_object_put(obj, js_cstring("heapFree"), js_value_make_double(heap_free));
+    js_object_put(obj, js_cstring("heapLargestFree"), js_value_make_double(heap_largest_free));
+    js_object_put(obj, js_cstring("heapFragmentation"), js_value_make_double(heap_fragmentation));
+    if(argc > 0 && js_value_is_truthy(argv[0])) {
+        // the detailed breakdown walks the whole heap, so it's only done on request:
+        js_census_entry_t census[JS_CENSUS_OTHER + 1];
+        js_gc_site_t sites[GC_STATS_SITES];
+        VAL by_type = js_make_object(vm);
+        VAL site_list[GC_STATS_SITES];
+        size_t site_count;
+        js_value_census(census);
+        for(i = 0; i <= JS_CENSUS_OTHER; i++) {
+            if(census[i].count) {
+                js_object_put(by_type, js_cstring(census[i].name), js_value_make_double(census[i].bytes));
+            }
+        }
+        js_object_put(obj, js_cstring("liveBytesByType"), by_type);
+        site_count = js_gc_allocation_sites(sites, GC_STATS_SITES);
+        for(i = 0; i < site_count; i++) {
+            VAL site = js_make_object(vm);
+            js_object_put(site, js_cstring("site"), js_value_wrap_string(js_string_format("%s:%d", sites[i].file, sites[i].line)));
+            js_object_put(site, js_cstring("count"), js_value_make_double(sites[i].count));
+            js_object_put(site, js_cstring("bytes"), js_value_make_double(sites[i].bytes));
+            site_list[i] = site;
+        }
+        js_object_put(obj, js_cstring("allocationSites"), js_make_array(vm, site_count, site_list));
+    }
+    return obj;
+}
+
+typedef struct {
+    char* buff;
+    size_t length;
+    size_t capacity;
+} snapshot_buffer_t;
+
+static void snapshot_write(const void* data, size_t length, void* state)
+{
+    snapshot_buffer_t* snap = state;
+    if(snap->buff == NULL) {
+        return;
+    }
+    if(snap->length + length > snap->capacity) {
+        // the snapshot is built in malloc's memory so the gc heap isn't touched mid-walk
+        char* buff = realloc(snap->buff, snap->capacity * 2 + length);
+        if(buff == NULL) {
+            free(snap->buff);
+            snap->buff = NULL;
+            return;
+        }
+        snap->buff = buff;
+        snap->capacity = snap->capacity * 2 + length;
+    }
+    memcpy(snap->buff + snap->length, data, length);
+    snap->length += length;
+}
+
+static VAL Kernel_heap_snapshot(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    snapshot_buffer_t snap;
+    VAL str;
+    snap.length = 0;
+    snap.capacity = 64 * 1024;
+    snap.buff = malloc(snap.capacity);
+    js_value_heap_snapshot(snapshot_write, &snap);
+    if(snap.buff == NULL) {
+        js_throw_error(vm->lib.RangeError, "Not enough memory for heap snapshot");
+    }
+    str = js_value_make_string(snap.buff, snap.length);
+    free(snap.buff);
+    return str;
+}
+
+#define MAX_MEMORY_PRESSURE_CALLBACKS 32
+
+/* a callback fires once when memory usage rises past its threshold, and again as
+   critical if a collection then finds that much memory still live. it's re-armed when
+   usage drops back below the threshold */
+typedef struct {
+    VAL fn;
+    double level;
+    size_t threshold;
+    bool armed;
+    bool critical_armed;
+} memory_pressure_callback_t;
+
+static memory_pressure_callback_t pressure_callbacks[MAX_MEMORY_PRESSURE_CALLBACKS];
+static uint32_t pressure_callback_count;
+static bool pressure_pending;
+static bool pressure_critical;
+
+static void call_memory_pressure_callback(memory_pressure_callback_t* callback, bool critical)
+{
+    VAL exception;
+    VAL args[2] = { js_value_make_double(callback->level), js_value_make_boolean(critical) };
+    JS_TRY({
+        js_call(callback->fn, Kernel, 2, args);
+    }, exception, {
+        kprintf("memory pressure callback threw: %s\n", js_value_get_pointer(js_to_string(exception))->string.buff);
+    });
+}
+
+static void update_memory_pressure_threshold()
+{
+    size_t usage = js_gc_memory_usage();
+    size_t threshold = (size_t)-1;
+    size_t critical_threshold = (size_t)-1;
+    memory_pressure_callback_t* callback;
+    uint32_t i;
+    for(i = 0; i < pressure_callback_count; i++) {
+        callback = &pressure_callbacks[i];
+        if(usage < callback->threshold) {
+            callback->armed = true;
+            callback->critical_armed = true;
+        }
+        if(callback->armed && callback->threshold < threshold) {
+            threshold = callback->threshold;
+        }
+        if(callback->critical_armed && callback->threshold < critical_threshold) {
+            critical_threshold = callback->threshold;
+        }
+    }
+    js_gc_set_pressure_threshold(threshold, critical_threshold);
+}
+
+static void memory_pressure(bool critical)
+{
+    // this is called from inside the collector, so calling into js is left for later:
+    pressure_pending = true;
+    if(critical) {
+        pressure_critical = true;
+    }
+}
+
+void kernel_dispatch_memory_pressure()
+{
+    size_t usage = js_gc_memory_usage();
+    bool critical = pressure_critical;
+    memory_pressure_callback_t* callback;
+    uint32_t i;
+    if(pressure_pending) {
+        pressure_pending = false;
+        pressure_critical = false;
+        for(i = 0; i < pressure_callback_count; i++) {
+            callback = &pressure_callbacks[i];
+            if(usage < callback->threshold) {
+                continue;
+            }
+            if(critical && callback->critical_armed) {
+                callback->armed = false;
+                callback->critical_armed = false;
+                call_memory_pressure_callback(callback, true);
+            } else if(callback->armed) {
+                callback->armed = false;
+                call_memory_pressure_callback(callback, false);
+            }
+        }
+    }
+    update_memory_pressure_threshold();
+}
+
+static VAL Kernel_on_memory_pressure(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    memory_pressure_callback_t* callback;
+    double level;
+    if(argc < 2 || js_value_get_type(argv[1]) != JS_T_FUNCTION) {
+        js_throw_error(vm->lib.TypeError, "expected level and function");
+    }
+    level = js_value_get_double(js_to_number(argv[0]));
+    if(!(level > 0 && level <= 1)) {
+        js_throw_error(vm->lib.RangeError, "memory pressure level must be a fraction of the heap between 0 and 1");
+    }
+    if(pressure_callback_count == MAX_MEMORY_PRESSURE_CALLBACKS) {
+        js_throw_error(vm->lib.Error, "too many memory pressure callbacks");
+    }
+    callback = &pressure_callbacks[pressure_callback_count++];
+    callback->fn = argv[1];
+    callback->level = level;
+    callback->threshold = level * mm_heap_size();
+    callback->armed = true;
+    callback->critical_armed = true;
+    update_memory_pressure_threshold();
+    return js_value_undefined();
+}
+
+static VAL Kernel_vm_stats(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    VAL obj = js_make_object(vm);
+    js_vm_stats_t stats;
+    uint64_t lookups;
+    js_vm_get_stats(&stats);
+    lookups = stats.lookup_cache_hits + stats.lookup_cache_misses;
+    js_object_put(obj, js_cstring("lookupCacheHits"), js_value_make_double(stats.lookup_cache_hits));
+    js_object_put(obj, js_cstring("lookupCacheMisses"), js_value_make_double(stats.lookup_cache_misses));
+    js_object_put(obj, js_cstring("lookupCacheHitRate"), js_value_make_double(lookups ? (double)stats.lookup_cache_hits / lookups : 0));
+    return obj;
+}
+
 extern int _binary_src_realmode_bin_start;
 
 static VAL Kernel_real_exec(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
@@ -66,7 +324,9 @@ static VAL Kernel_panic(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL*
 static VAL Kernel_memcpy(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t dest, src, len;
-    js_scan_args(vm, argc, argv, "III", &dest, &src, &len);
+    dest = js_arg_uint32(vm, argc, argv, 0);
+    src = js_arg_uint32(vm, argc, argv, 1);
+    len = js_arg_uint32(vm, argc, argv, 2);
     memcpy((void*)dest, (void*)src, len);
     return js_value_undefined();
 }
@@ -74,7 +334,9 @@ static VAL Kernel_memcpy(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL*
 static VAL Kernel_memset(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t ptr, val, count;
-    js_scan_args(vm, argc, argv, "III", &ptr, &val, &count);
+    ptr = js_arg_uint32(vm, argc, argv, 0);
+    val = js_arg_uint32(vm, argc, argv, 1);
+    count = js_arg_uint32(vm, argc, argv, 2);
     memset((void*)ptr, (uint8_t)val, count);
     return js_value_undefined();
 }
@@ -82,7 +344,8 @@ static VAL Kernel_memset(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL*
 static VAL Kernel_read_memory(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t addr, size;
-    js_scan_args(vm, argc, argv, "II", &addr, &size);
+    addr = js_arg_uint32(vm, argc, argv, 0);
+    size = js_arg_uint32(vm, argc, argv, 1);
     return js_value_make_string((void*)addr, size);
 }
 
@@ -91,7 +354,8 @@ static VAL Kernel_write_memory(js_vm_t* vm, void* state, VAL this, uint32_t argc
     uint32_t addr;
     VAL buff;
     js_string_t* str;
-    js_scan_args(vm, argc, argv, "IS", &addr, &buff);
+    addr = js_arg_uint32(vm, argc, argv, 0);
+    buff = js_arg_string(vm, argc, argv, 1);
     str = &js_value_get_pointer(buff)->string;
     memcpy((void*)addr, str->buff, str->length);
     return js_value_undefined();
@@ -122,28 +386,29 @@ static VAL Kernel_write_byte_array_to_memory(js_vm_t* vm, void* state, VAL this,
 static VAL Kernel_peek8(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t addr;
-    js_scan_args(vm, argc, argv, "I", &addr);
+    addr = js_arg_uint32(vm, argc, argv, 0);
     return js_value_make_double(*(uint8_t*)addr);
 }
 
 static VAL Kernel_peek16(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t addr;
-    js_scan_args(vm, argc, argv, "I", &addr);
+    addr = js_arg_uint32(vm, argc, argv, 0);
     return js_value_make_double(*(uint16_t*)addr);
 }
 
 static VAL Kernel_peek32(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t addr;
-    js_scan_args(vm, argc, argv, "I", &addr);
+    addr = js_arg_uint32(vm, argc, argv, 0);
     return js_value_make_double(*(uint32_t*)addr);
 }
 
 static VAL Kernel_poke8(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t addr, val;
-    js_scan_args(vm, argc, argv, "II", &addr, &val);
+    addr = js_arg_uint32(vm, argc, argv, 0);
+    val = js_arg_uint32(vm, argc, argv, 1);
     *(uint8_t*)addr = (uint8_t)val;
     return js_value_undefined();
 }
@@ -151,7 +416,8 @@ static VAL Kernel_poke8(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL*
 static VAL Kernel_poke16(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t addr, val;
-    js_scan_args(vm, argc, argv, "II", &addr, &val);
+    addr = js_arg_uint32(vm, argc, argv, 0);
+    val = js_arg_uint32(vm, argc, argv, 1);
     *(uint16_t*)addr = (uint16_t)val;
     return js_value_undefined();
 }
@@ -159,7 +425,8 @@ static VAL Kernel_poke16(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL*
 static VAL Kernel_poke32(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t addr, val;
-    js_scan_args(vm, argc, argv, "II", &addr, &val);
+    addr = js_arg_uint32(vm, argc, argv, 0);
+    val = js_arg_uint32(vm, argc, argv, 1);
     *(uint32_t*)addr = (uint32_t)val;
     return js_value_undefined();
 }
@@ -167,14 +434,14 @@ static VAL Kernel_poke32(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL*
 static VAL Kernel_malloc(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t sz;
-    js_scan_args(vm, argc, argv, "I", &sz);
+    sz = js_arg_uint32(vm, argc, argv, 0);
     return js_value_make_double((uint32_t)malloc(sz));
 }
 
 static VAL Kernel_free(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     uint32_t ptr;
-    js_scan_args(vm, argc, argv, "I", &ptr);
+    ptr = js_arg_uint32(vm, argc, argv, 0);
     free((void*)ptr);
     return js_value_undefined();
 }
@@ -218,11 +485,18 @@ void lib_kernel_init(js_vm_t* vm)
 {
     Kernel = js_make_object(vm);
     js_gc_register_global(&Kernel, sizeof(Kernel));
+    js_gc_register_global(pressure_callbacks, sizeof(pressure_callbacks));
+    js_gc_set_pressure_handler(memory_pressure);
     js_object_put(vm->global_scope->global_object, js_cstring("Kernel"), Kernel);
     
     js_object_put(Kernel, js_cstring("loadImage"), js_value_make_native_function(vm, NULL, js_cstring("loadImage"), Kernel_load_image, NULL));
     js_object_put(Kernel, js_cstring("memoryUsage"), js_value_make_native_function(vm, NULL, js_cstring("memoryUsage"), Kernel_memory_usage, NULL));
     js_object_put(Kernel, js_cstring("runGC"), js_value_make_native_function(vm, NULL, js_cstring("runGC"), Kernel_run_gc, NULL));
+    js_object_put(Kernel, js_cstring("compactHeap"), js_value_make_native_function(vm, NULL, js_cstring("compactHeap"), Kernel_compact_heap, NULL));
+    js_object_put(Kernel, js_cstring("gcStats"), js_value_make_native_function(vm, NULL, js_cstring("gcStats"), Kernel_gc_stats, NULL));
+    js_object_put(Kernel, js_cstring("heapSnapshot"), js_value_make_native_function(vm, NULL, js_cstring("heapSnapshot"), Kernel_heap_snapshot, NULL));
+    js_object_put(Kernel, js_cstring("vmStats"), js_value_make_native_function(vm, NULL, js_cstring("vmStats"), Kernel_vm_stats, NULL));
+    js_object_put(Kernel, js_cstring("onMemoryPressure"), js_value_make_native_function(vm, NULL, js_cstring("onMemoryPressure"), Kernel_on_memory_pressure, NULL));
     js_object_put(Kernel, js_cstring("realExec"), js_value_make_native_function(vm, NULL, js_cstring("realExec"), Kernel_real_exec, NULL));
     js_object_put(Kernel, js_cstring("panic"), js_value_make_native_function(vm, NULL, js_cstring("panic"), Kernel_panic, NULL));
     js_object_put(Kernel, js_cstring("memcpy"), js_value_make_native_function(vm, NULL, js_cstring("memcpy"), Kernel_memcpy, NULL));
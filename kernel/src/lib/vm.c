@@ -55,6 +55,25 @@ static VAL VM_prototype_globals_set(js_vm_t* vm, void* state, VAL this, uint32_t
     return get_vm(vm, this)->global_scope->global_object = argv[0];
 }
 
+static VAL VM_prototype_memory_usage(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    return js_value_make_double(js_gc_region_usage(get_vm(vm, this)->region));
+}
+
+static VAL VM_prototype_memory_limit(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    return js_value_make_double(js_gc_region_limit(get_vm(vm, this)->region));
+}
+
+static VAL VM_prototype_memory_limit_set(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    if(argc == 0 || js_value_get_type(argv[0]) != JS_T_NUMBER) {
+        js_throw_error(vm->lib.TypeError, "expected number as first argument");
+    }
+    js_gc_region_set_limit(get_vm(vm, this)->region, js_to_uint32(argv[0]));
+    return argv[0];
+}
+
 static VAL VM_prototype_execute(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     if(argc == 0 || (js_value_get_type(argv[0]) != JS_T_STRING && js_value_get_type(argv[0]) != JS_T_FUNCTION)) {
@@ -106,6 +125,18 @@ static VAL VM_prototype_expose_function(js_vm_t* vm, void* state, VAL this, uint
     return user_fn_val;
 }
 
+static VAL VM_prototype_destroy(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_vm_t* target_vm = get_vm(vm, this);
+    // the vm's objects can't be freed here as the kernel may still hold references to
+    // some of them, but its region stops being enforced and the collector reclaims the rest:
+    if(target_vm == vm) {
+        js_throw_error(vm->lib.Error, "a VM can't destroy itself");
+    }
+    js_gc_region_release(target_vm->region);
+    return js_value_undefined();
+}
+
 static VAL VM_prototype_create_object(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     return js_make_object(get_vm(vm, this));
@@ -128,9 +159,12 @@ void lib_vm_init(js_vm_t* vm)
     js_object_put_accessor(vm, VM, "self", VM_self, NULL);
     js_object_put_accessor(vm, VM_prototype, "id", VM_prototype_id, NULL);
     js_object_put_accessor(vm, VM_prototype, "globals", VM_prototype_globals, VM_prototype_globals_set);
+    js_object_put_accessor(vm, VM_prototype, "memoryUsage", VM_prototype_memory_usage, NULL);
+    js_object_put_accessor(vm, VM_prototype, "memoryLimit", VM_prototype_memory_limit, VM_prototype_memory_limit_set);
     
     // instance methods:
     js_object_put(VM_prototype, js_cstring("execute"), js_value_make_native_function(vm, NULL, js_cstring("execute"), VM_prototype_execute, NULL));
+    js_object_put(VM_prototype, js_cstring("destroy"), js_value_make_native_function(vm, NULL, js_cstring("destroy"), VM_prototype_destroy, NULL));
     js_object_put(VM_prototype, js_cstring("exposeFunction"), js_value_make_native_function(vm, NULL, js_cstring("exposeFunction"), VM_prototype_expose_function, NULL));
     js_object_put(VM_prototype, js_cstring("createObject"), js_value_make_native_function(vm, NULL, js_cstring("createObject"), VM_prototype_create_object, NULL));
     js_object_put(VM_prototype, js_cstring("createArray"), js_value_make_native_function(vm, NULL, js_cstring("createArray"), VM_prototype_create_array, NULL));
@@ -33,7 +33,7 @@ static void unhandled_exception(VAL exception)
     if(js_value_is_object(exception) && js_value_get_pointer(exception)->object.stack_trace) {
         panicf("Unhandled exception: %s\n%s",
             js_value_get_pointer(js_to_string(exception))->string.buff,
-            js_value_get_pointer(exception)->object.stack_trace->buff);
+            js_stack_trace_string(js_value_get_pointer(exception)->object.stack_trace)->buff);
     } else {
         panicf("Unhandled exception: %s\n", js_value_get_pointer(js_to_string(exception))->string.buff);
     }
@@ -3507,6 +3507,37 @@ struct mallinfo mALLINFo(RONEARG) RDECL
   return ret;
 }
 
+/*
+  malloc_free_space (jsos addition):
+
+    Reports the total free space in the arena and the size of the
+    largest single free chunk, so fragmentation can be measured.
+*/
+
+void malloc_free_space(size_t* total, size_t* largest)
+{
+  int i;
+  mbinptr b;
+  mchunkptr p;
+  INTERNAL_SIZE_T avail = chunksize(top);
+  INTERNAL_SIZE_T biggest = avail;
+
+  MALLOC_LOCK;
+  for (i = 1; i < NAV; ++i)
+  {
+    b = bin_at(i);
+    for (p = last(b); p != b; p = p->bk) 
+    {
+      avail += chunksize(p);
+      if (chunksize(p) > biggest)
+        biggest = chunksize(p);
+    }
+  }
+  MALLOC_UNLOCK;
+  *total = avail;
+  *largest = biggest;
+}
+
 #endif /* DEFINE_MALLINFO */
 
 #ifdef DEFINE_MALLOPT
@@ -73,6 +73,11 @@ void mm_init(multiboot_memory_map_t* mmap, uint32_t length, uint32_t highest_mod
     panic("did not find suitable memory region");
 }
 
+uint32_t mm_heap_size()
+{
+    return max_size;
+}
+
 void* sbrk(int32_t increment)
 {
     if(increment < 0 && ((uint32_t)-increment) > current_increment) {
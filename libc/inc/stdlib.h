@@ -9,6 +9,7 @@ int atoi(char* str);
 void* malloc(size_t size);
 void* realloc(void* pointer, size_t size);
 void free(void* pointer);
+void* memalign(size_t alignment, size_t size);
 
 void exit(int)
 #ifdef __GNUC__
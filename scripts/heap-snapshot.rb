@@ -0,0 +1,212 @@
+# coding: utf-8
+#
+# summarises a heap snapshot, or diffs two of them:
+#
+#   ruby scripts/heap-snapshot.rb snapshot.bin
+#   ruby scripts/heap-snapshot.rb before.bin after.bin
+#
+# snapshots come from Kernel.heapSnapshot() (write the string out over serial,
+# eg. with Kernel.serial.writeString) or from `runner -h snapshot.bin`. the format
+# is described above js_gc_snapshot in vm/src/gc.c
+
+class HeapSnapshot
+  Node = Struct.new(:address, :size, :type, :site, :edges, :retained)
+
+  attr_reader :types, :sites, :roots, :nodes
+
+  def initialize(data)
+    @data = data.b
+    @pos = 0
+    raise "not a heap snapshot" unless @data[0, 4] == "JSHS"
+    @pos = 4
+    version = byte
+    raise "unsupported snapshot version #{version}" unless version == 1
+    @types = Array.new(varint) { string }
+    @sites = { 0 => "(unknown)" }
+    varint.times do
+      id = varint
+      file = string
+      @sites[id] = "#{file}:#{varint}"
+    end
+    @roots = list
+    @nodes = {}
+    until (address = varint).zero?
+      @nodes[address] = Node.new(address, varint, @types[varint] || "?", @sites[varint] || "?", list, 0)
+    end
+    compute_retained_sizes
+  end
+
+  # totals of [count, bytes, retained bytes] keyed on whatever the block returns
+  def totals
+    totals = Hash.new { |h, k| h[k] = [0, 0, 0] }
+    @nodes.each_value do |node|
+      t = totals[yield(node)]
+      t[0] += 1
+      t[1] += node.size
+      t[2] += node.retained
+    end
+    totals
+  end
+
+  def total_size
+    @nodes.each_value.sum(&:size)
+  end
+
+  private
+
+  def byte
+    b = @data.getbyte(@pos) or raise "truncated heap snapshot"
+    @pos += 1
+    b
+  end
+
+  def varint
+    value = 0
+    shift = 0
+    loop do
+      b = byte
+      value |= (b & 0x7f) << shift
+      shift += 7
+      return value if b < 0x80
+    end
+  end
+
+  def string
+    len = varint
+    str = @data[@pos, len]
+    @pos += len
+    str
+  end
+
+  def list
+    items = []
+    until (item = varint).zero?
+      items << item
+    end
+    items
+  end
+
+  # an allocation's retained size is its own size plus everything it dominates -
+  # the memory that would be freed if it went away. dominators are found with the
+  # iterative algorithm from Cooper, Harvey & Kennedy's "A Simple, Fast Dominance
+  # Algorithm", over a graph with a synthetic root (index 0) pointing at every
+  # real root. allocations nothing seems to reach hang off the synthetic root too
+  def compute_retained_sizes
+    nodes = [nil] + @nodes.values
+    index = {}
+    nodes.each_with_index { |node, i| index[node.address] = i if node }
+    succs = nodes.map { |node| node ? node.edges.map { |e| index[e] }.compact.uniq : [] }
+    succs[0] = @roots.map { |r| index[r] }.compact.uniq
+
+    # reverse postorder from the synthetic root, without recursion:
+    order = []
+    visited = Array.new(nodes.size, false)
+    visited[0] = true
+    stack = [[0, 0]]
+    until stack.empty?
+      n, i = stack.last
+      if i < succs[n].size
+        stack.last[1] += 1
+        s = succs[n][i]
+        next if visited[s]
+        visited[s] = true
+        stack << [s, 0]
+      else
+        order << n
+        stack.pop
+      end
+    end
+    (1...nodes.size).each do |n|
+      next if visited[n]
+      succs[0] << n
+      order.unshift n
+    end
+    order.reverse!
+
+    rpo = Array.new(nodes.size)
+    order.each_with_index { |n, i| rpo[n] = i }
+    preds = Array.new(nodes.size) { [] }
+    succs.each_with_index { |ss, n| ss.each { |s| preds[s] << n } }
+
+    idom = Array.new(nodes.size)
+    idom[0] = 0
+    changed = true
+    while changed
+      changed = false
+      order.drop(1).each do |n|
+        new_idom = nil
+        preds[n].each do |p|
+          next unless idom[p]
+          new_idom = new_idom ? intersect(p, new_idom, idom, rpo) : p
+        end
+        if new_idom != idom[n]
+          idom[n] = new_idom
+          changed = true
+        end
+      end
+    end
+
+    retained = Array.new(nodes.size, 0)
+    order.reverse_each do |n|
+      next if n.zero?
+      retained[n] += nodes[n].size
+      retained[idom[n]] += retained[n]
+    end
+    nodes.each_with_index { |node, i| node.retained = retained[i] if node }
+  end
+
+  def intersect(a, b, idom, rpo)
+    until a == b
+      a = idom[a] while rpo[a] > rpo[b]
+      b = idom[b] while rpo[b] > rpo[a]
+    end
+    a
+  end
+end
+
+def print_table(title, rows, columns)
+  puts title
+  puts "  " + columns.map { |c| c.rjust(12) }.join + "  name"
+  rows.each do |name, values|
+    puts "  " + values.map { |v| v.to_s.rjust(12) }.join + "  #{name}"
+  end
+  puts
+end
+
+LIMIT = 25
+
+def summarise(snap)
+  puts "#{snap.nodes.size} allocations, #{snap.total_size} bytes, #{snap.roots.uniq.size} roots"
+  puts
+  %w(type site).each do |key|
+    rows = snap.totals { |node| node[key] }.sort_by { |_, (_, bytes, _)| -bytes }.first(LIMIT)
+    print_table("by #{key}:", rows, %w(count bytes retained))
+  end
+  biggest = snap.nodes.values.sort_by { |node| -node.retained }.first(LIMIT)
+  print_table("biggest retainers:", biggest.map { |node| ["0x%x %s (%s)" % [node.address, node.type, node.site], [node.size, node.retained]] }, %w(size retained))
+end
+
+def diff(before, after)
+  puts "#{after.nodes.size - before.nodes.size} allocations, #{after.total_size - before.total_size} bytes"
+  puts
+  %w(type site).each do |key|
+    old = before.totals { |node| node[key] }
+    new = after.totals { |node| node[key] }
+    rows = (old.keys | new.keys).map do |name|
+      a = old.fetch(name, [0, 0, 0])
+      b = new.fetch(name, [0, 0, 0])
+      [name, b.zip(a).map { |x, y| x - y }]
+    end
+    rows = rows.reject { |_, d| d.all?(&:zero?) }.sort_by { |_, (_, bytes, _)| -bytes.abs }.first(LIMIT)
+    print_table("growth by #{key}:", rows, %w(count bytes retained))
+  end
+end
+
+case ARGV.size
+when 1
+  summarise HeapSnapshot.new(File.binread(ARGV[0]))
+when 2
+  diff HeapSnapshot.new(File.binread(ARGV[0])), HeapSnapshot.new(File.binread(ARGV[1]))
+else
+  abort "usage: ruby #{$0} snapshot [later-snapshot]"
+end
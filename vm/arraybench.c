@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "gc.h"
+#include "vm.h"
+#include "lib.h"
+#include "bench.h"
+
+/* regression benchmark for arrays written to at huge indices, which used to allocate
+   a slot for every index below the one written */
+
+#define ARRAYS 100
+#define HUGE_INDEX 1000000
+#define FILL 100000
+
+/* gc roots */
+static js_vm_t* vm;
+static js_value_t* arrays[ARRAYS + 2];
+
+static size_t collect()
+{
+    js_gc_run();
+    js_gc_finish_sweep();
+    return js_gc_memory_usage();
+}
+
+static VAL array(uint32_t i)
+{
+    return js_value_make_pointer(arrays[i]);
+}
+
+static void report(char* name, clock_t start, size_t memory_before)
+{
+    double ms = elapsed(start);
+    printf("%-28s %8.2fms %10ld bytes retained\n", name, ms, (long)collect() - (long)memory_before);
+}
+
+static void realmain()
+{
+    size_t memory;
+    clock_t start;
+    uint32_t i, j;
+
+    BENCH_ROOT(vm);
+    BENCH_ROOT(arrays);
+    vm = js_vm_new();
+    memory = collect();
+    start = clock();
+    for(i = 0; i < ARRAYS; i++) {
+        arrays[i] = js_value_get_pointer(js_make_array(vm, 0, NULL));
+        js_object_put_index(array(i), HUGE_INDEX + i, js_value_make_double(i));
+    }
+    report("a[1000000] = x, 100 arrays", start, memory);
+
+    memory = collect();
+    start = clock();
+    arrays[ARRAYS] = js_value_get_pointer(js_make_array(vm, 0, NULL));
+    for(i = FILL; i > 0; i--) {
+        js_object_put_index(array(ARRAYS), i - 1, js_value_make_double(i));
+    }
+    report("fill 100000 from the top", start, memory);
+
+    memory = collect();
+    start = clock();
+    arrays[ARRAYS + 1] = js_value_get_pointer(js_make_array(vm, 0, NULL));
+    for(i = 0; i < FILL; i++) {
+        js_object_put_index(array(ARRAYS + 1), i, js_value_make_double(i));
+    }
+    report("fill 100000 from the bottom", start, memory);
+
+    memory = collect();
+    start = clock();
+    for(i = 0; i < FILL; i++) {
+        if(i % 10) {
+            js_object_delete(array(ARRAYS + 1), js_string_format("%u", i));
+        }
+    }
+    for(i = 0, j = 0; i < FILL; i += 10) {
+        j += js_value_get_double(js_object_get_index(array(ARRAYS + 1), i)) == i;
+    }
+    report("delete 90% then read", start, memory);
+    if(j != FILL / 10) {
+        printf("  read back %u items, expected %u\n", j, FILL / 10);
+    }
+}
+
+int main()
+{
+    uint32_t dummy;
+    js_gc_init(&dummy);
+    realmain();
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef JS_BENCH_H
+#define JS_BENCH_H
+
+#include <time.h>
+#include "gc.h"
+
+/* bits shared by the *bench.c programs */
+
+/* in milliseconds */
+static double elapsed(clock_t start)
+{
+    return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+/* registers a global as a gc root, so whatever it points at survives the collections
+   between tests. the collector only recognises plain pointers in globals, so roots
+   must hold pointers rather than NaN boxed VALs */
+#define BENCH_ROOT(var) js_gc_register_global(&(var), sizeof(var))
+
+#endif
@@ -35,7 +35,11 @@ int main()
     image = js_image_parse(buff, len);
     printf("read %d sections\n", image->section_count);
     for(i = 0; i < image->section_count; i++) {
-        printf("\nsection %d (flags %d, var count: %d):\n", i, image->sections[i].flags, image->sections[i].var_count);
+        printf("\nsection %d (flags %d, var count: %d, local count: %d):\n", i, image->sections[i].flags, image->sections[i].var_count, image->sections[i].local_count);
+        for(j = 0; j < image->sections[i].exception_range_count; j++) {
+            js_exception_range_t* range = &image->sections[i].exception_ranges[j];
+            printf("    try %04d-%04d: handler %04d, finally %04d\n", range->start, range->end, range->handler, range->finally);
+        }
         for(j = 0; j < image->sections[i].instruction_count; j++) {
             op = image->sections[i].instructions[j];
             printf("    %04d  %-12s", j, js_instruction(op)->name);
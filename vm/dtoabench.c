@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include "gc.h"
+#include "value.h"
+#include "dtoa.h"
+#include "bench.h"
+
+/* checks number to string conversion against the C library and compares its speed
+   with the conversion it replaced, which printed six fractional digits */
+
+#define RANDOM_DOUBLES 200000
+#define TIMED_CONVERSIONS 1000000
+
+static js_string_t* old_string_from_double(double number)
+{
+    if(number != number) {
+        return js_cstring("NaN");
+    }
+    if(!isfinite(number)) {
+        if(number > 0) {
+            return js_cstring("Infinity");
+        } else {
+            return js_cstring("-Infinity");
+        }
+    }
+    double whole = floor(number);
+    double frac = fabs(number) - fabs(whole);
+    char buff[1024];
+    char* ptr = buff;
+    if(whole < 0) {
+        *ptr++ = '-';
+        whole = -number;
+    }
+    if(whole == 0) {
+        *ptr++ = '0';
+    }
+    char minibuff[1024];
+    memset(minibuff, 0, 1024);
+    uint32_t minibuff_i = 0;
+    while(whole > 0) {
+        minibuff[minibuff_i++] = '0' + (int)fmod(whole, 10.0);
+        whole = floor(whole / 10.0);
+    }
+    while(minibuff_i > 0) {
+        *ptr++ = minibuff[--minibuff_i];
+    }
+    uint32_t frac_i;
+    if(frac > 0) {
+        *ptr++ = '.';
+        for(frac_i = 0; frac_i < 6; frac_i++) {
+            frac = fmod(frac * 10.0, 10.0);
+            *ptr++ = '0' + (int)floor(frac);
+        }
+    }
+    *ptr++ = 0;
+    return js_cstring(buff);
+}
+
+static uint64_t random_state = 88172645463325252ull;
+
+static double random_double()
+{
+    union {
+        uint64_t i;
+        double d;
+    } u;
+    do {
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        u.i = random_state & 0x7fffffffffffffffull;
+    } while(u.d == 0 || !isfinite(u.d));
+    return u.d;
+}
+
+static bool reads_back(double value, uint64_t mantissa, int32_t exponent)
+{
+    char buff[64];
+    sprintf(buff, "%llue%d", (unsigned long long)mantissa, exponent);
+    return strtod(buff, NULL) == value;
+}
+
+/* the fewest digits that read back, found by trying the C library's correctly
+   rounded digits at each precision along with their neighbours, since the shortest
+   digits needn't be the nearest ones. nearest is set to the correctly rounded
+   digits if they're among the shortest, and to 0 if not */
+static uint32_t shortest_printf(double value, uint64_t* nearest)
+{
+    char buff[64];
+    uint32_t precision;
+    for(precision = 0; precision < JS_DTOA_MAX_DIGITS - 1; precision++) {
+        uint64_t mantissa = 0;
+        int32_t exponent;
+        char* ptr;
+        sprintf(buff, "%.*e", precision, value);
+        for(ptr = buff; *ptr != 'e'; ptr++) {
+            if(*ptr != '.') {
+                mantissa = mantissa * 10 + (*ptr - '0');
+            }
+        }
+        exponent = atoi(ptr + 1) - precision;
+        *nearest = reads_back(value, mantissa, exponent) ? mantissa : 0;
+        if(*nearest || reads_back(value, mantissa - 1, exponent) || reads_back(value, mantissa + 1, exponent)) {
+            break;
+        }
+    }
+    return precision + 1;
+}
+
+/* one failure is enough to tell something's off, so only the first few are shown */
+static uint32_t failures;
+
+/* the digits have to read back, be as few as possible, and be the nearest ones when
+   more than one string of that length reads back */
+static void check(double value)
+{
+    char digits[JS_DTOA_MAX_DIGITS];
+    int32_t point;
+    uint32_t count = js_dtoa_shortest(value, digits, &point), i;
+    uint64_t mantissa = 0, nearest;
+    uint32_t expected_count = shortest_printf(value, &nearest);
+    for(i = 0; i < count; i++) {
+        mantissa = mantissa * 10 + (digits[i] - '0');
+    }
+    for(i = count; i < expected_count; i++) {
+        mantissa *= 10;
+    }
+    if(count > expected_count || !reads_back(value, mantissa, point - expected_count) || (nearest && mantissa != nearest)) {
+        if(failures++ < 10) {
+            printf("  %.17g: got %.*s * 10^%d, expected %u digits\n", value,
+                (int)count, digits, point, expected_count);
+        }
+    }
+}
+
+static void check_string(double value, char* expected)
+{
+    js_string_t* str = js_string_from_double(value);
+    if(strcmp(str->buff, expected)) {
+        if(failures++ < 10) {
+            printf("  %.17g: got %s, expected %s\n", value, str->buff, expected);
+        }
+    }
+}
+
+static void conformance()
+{
+    uint32_t i;
+    union {
+        uint64_t i;
+        double d;
+    } u;
+    clock_t start = clock();
+    failures = 0;
+    for(i = 0; i < RANDOM_DOUBLES; i++) {
+        check(random_double());
+    }
+    // denormals, the edges of the normals, and every power of two and ten:
+    for(u.i = 1; u.i < 1000; u.i++) {
+        check(u.d);
+    }
+    u.i = 0x000fffffffffffffull;
+    check(u.d);
+    u.i = 0x0010000000000000ull;
+    check(u.d);
+    u.i = 0x7fefffffffffffffull;
+    check(u.d);
+    for(i = 1; i < 2046; i++) {
+        u.i = (uint64_t)i << 52;
+        check(u.d);
+    }
+    for(i = 0; i <= 308; i++) {
+        check(strtod("1e308", NULL) / pow(10, i));
+    }
+    check_string(0.1, "0.1");
+    check_string(-0.0, "0");
+    check_string(123.456, "123.456");
+    check_string(-1.5, "-1.5");
+    check_string(1e21, "1e+21");
+    check_string(1e20, "100000000000000000000");
+    check_string(123456789012345680000.0, "123456789012345680000");
+    check_string(4294967295.0, "4294967295");
+    check_string(0.000001, "0.000001");
+    check_string(1e-7, "1e-7");
+    check_string(1.5e-7, "1.5e-7");
+    check_string(5e-324, "5e-324");
+    check_string(1.7976931348623157e308, "1.7976931348623157e+308");
+    check_string(0.1 + 0.2, "0.30000000000000004");
+    check_string(1.0 / 3, "0.3333333333333333");
+    check_string(-2147483648.0, "-2147483648");
+    printf("%-34s %8.2fms %u failures\n", "conformance", elapsed(start), failures);
+}
+
+static void throughput(char* name, js_string_t* (*convert)(double), double (*make)(uint32_t))
+{
+    uint32_t i, length = 0;
+    clock_t start = clock();
+    for(i = 0; i < TIMED_CONVERSIONS; i++) {
+        length += convert(make(i))->length;
+    }
+    printf("%-34s %8.2fns per conversion (%u characters)\n", name,
+        elapsed(start) * 1000000 / TIMED_CONVERSIONS, length);
+}
+
+/* the digits alone, without making a string of them */
+static void digits_throughput(char* name)
+{
+    char digits[JS_DTOA_MAX_DIGITS];
+    uint32_t i, length = 0;
+    int32_t point;
+    clock_t start = clock();
+    for(i = 0; i < TIMED_CONVERSIONS; i++) {
+        length += js_dtoa_shortest(random_double(), digits, &point);
+    }
+    printf("%-34s %8.2fns per conversion (%u digits)\n", name,
+        elapsed(start) * 1000000 / TIMED_CONVERSIONS, length);
+}
+
+static double make_integer(uint32_t i)
+{
+    return i * 7;
+}
+
+static double make_fraction(uint32_t i)
+{
+    return i / 64.0 + 0.25;
+}
+
+static double make_random(uint32_t i)
+{
+    return random_double();
+}
+
+static double make_large(uint32_t i)
+{
+    return i * 1e12 + 0.5;
+}
+
+int main()
+{
+    uint32_t dummy;
+    js_gc_init(&dummy);
+    conformance();
+    throughput("integers, old", old_string_from_double, make_integer);
+    throughput("integers, new", js_string_from_double, make_integer);
+    throughput("short fractions, old", old_string_from_double, make_fraction);
+    throughput("short fractions, new", js_string_from_double, make_fraction);
+    throughput("random bits, old", old_string_from_double, make_random);
+    throughput("random bits, new", js_string_from_double, make_random);
+    throughput("large with fractions, old", old_string_from_double, make_large);
+    throughput("large with fractions, new", js_string_from_double, make_large);
+    digits_throughput("random bits, digits only");
+    return 0;
+}
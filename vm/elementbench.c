@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "gc.h"
+#include "vm.h"
+#include "lib.h"
+#include "proptable.h"
+#include "bench.h"
+
+/* times the integer keyed lookups the kernel does most, going through strings and
+   the property table the way every index used to, through js_object_get with a
+   string key, and through js_object_get_index */
+
+#define ROUNDS 200000
+
+typedef struct {
+    char* name;
+    uint32_t first;
+    uint32_t count;
+} table_t;
+
+static table_t tables[] = {
+    // Process#fds: a handful of small descriptors
+    { "fd table", 0, 8 },
+    // Kernel.isrs: the 16 irqs remapped to start at 32
+    { "isr table", 32, 16 },
+};
+
+static void bench(js_vm_t* vm, table_t* table)
+{
+    js_proptable_t* properties = js_proptable_new();
+    VAL obj = js_make_object(vm);
+    void* descr;
+    uint32_t i, r, found = 0;
+    clock_t start;
+    double strings, get, get_index;
+    for(i = table->first; i < table->first + table->count; i++) {
+        js_proptable_insert(properties, js_string_from_double(i), js_alloc(sizeof(js_property_descriptor_t)));
+        js_object_put_index(obj, i, js_value_make_double(i));
+    }
+    start = clock();
+    for(r = 0; r < ROUNDS; r++) {
+        for(i = table->first; i < table->first + table->count; i++) {
+            found += js_proptable_lookup(properties, js_string_from_double(i), &descr);
+        }
+    }
+    strings = elapsed(start);
+    start = clock();
+    for(r = 0; r < ROUNDS; r++) {
+        for(i = table->first; i < table->first + table->count; i++) {
+            found += js_value_get_double(js_object_get(obj, js_string_from_double(i))) == i;
+        }
+    }
+    get = elapsed(start);
+    start = clock();
+    for(r = 0; r < ROUNDS; r++) {
+        for(i = table->first; i < table->first + table->count; i++) {
+            found += js_value_get_double(js_object_get_index(obj, i)) == i;
+        }
+    }
+    get_index = elapsed(start);
+    printf("%-10s string + property table %8.2fms  js_object_get %8.2fms  js_object_get_index %8.2fms\n",
+        table->name, strings, get, get_index);
+    if(found != 3 * ROUNDS * table->count) {
+        printf("  found %u keys, expected %u\n", found, 3 * ROUNDS * table->count);
+    }
+}
+
+static void realmain()
+{
+    js_vm_t* vm = js_vm_new();
+    uint32_t i;
+    for(i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+        bench(vm, &tables[i]);
+    }
+}
+
+int main()
+{
+    uint32_t dummy;
+    js_gc_init(&dummy);
+    realmain();
+    return 0;
+}
@@ -15,10 +15,38 @@ void realmain()
     printf("x = %d\n", *x);
 }
 
+void compactmain()
+{
+    char** owners;
+    uint32_t i;
+    js_gc_stats_t stats;
+    owners = js_alloc(sizeof(char*) * 1000);
+    for(i = 0; i < 1000; i++) {
+        owners[i] = js_alloc_movable(500, &owners[i]);
+        owners[i][0] = i % 100;
+        if(i % 4) {
+            owners[i] = NULL;
+        }
+    }
+    js_gc_run();
+    js_gc_finish_sweep();
+    js_gc_get_stats(&stats);
+    printf("before compacting: %u chunks, %u%% fragmented\n", (uint32_t)stats.movable_chunks, stats.movable_fragmentation);
+    js_gc_compact();
+    js_gc_get_stats(&stats);
+    printf("after compacting: %u chunks, %u%% fragmented\n", (uint32_t)stats.movable_chunks, stats.movable_fragmentation);
+    for(i = 0; i < 1000; i += 4) {
+        if(owners[i][0] != i % 100) {
+            printf("block %u was corrupted by compaction\n", i);
+        }
+    }
+}
+
 int main()
 {
     int x;
     js_gc_init(&x);
     realmain();
+    compactmain();
     return 0;
 }
\ No newline at end of file
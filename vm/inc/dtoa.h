@@ -0,0 +1,23 @@
+#ifndef JS_DTOA_H
+#define JS_DTOA_H
+
+#include <stdint.h>
+
+/* a double never needs more than this many significant digits to read back exactly */
+#define JS_DTOA_MAX_DIGITS 17
+
+/* writes the fewest decimal digits that read back as value, which has to be finite
+   and greater than zero, and returns how many were written. the digits aren't nul
+   terminated, and value is 0.d1d2d3... * 10^*point */
+uint32_t js_dtoa_shortest(double value, char* digits, int32_t* point);
+
+/* any digits past this many only matter for rounding, so a parser can keep this
+   many, then add a 1 if any of the rest weren't 0 */
+#define JS_DTOA_MAX_PARSE_DIGITS 768
+
+/* the double nearest 0.d1d2d3... * 10^point, for count digits, with ties going to
+   the even one. the first digit has to be non-zero, unless it's the only one, and
+   count can be up to JS_DTOA_MAX_PARSE_DIGITS + 1 */
+double js_dtoa_parse(char* digits, uint32_t count, int32_t point);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef JS_ELEMENTS_H
+#define JS_ELEMENTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "value.h"
+
+/* integer keyed storage for ordinary objects, so obj[n] doesn't have to go through
+   a string and the property table. elements start out as a vector indexed directly
+   by key and switch over to an open addressed hash of keys when they get too sparse
+   for that to be sensible. only plain data properties (writable, enumerable and
+   configurable) live here - anything else with an index key goes in the property
+   table like any other property */
+
+typedef struct js_elements {
+    uint32_t count;     // elements present
+    uint32_t capacity;  // slots in values (and keys when sparse), a power of two once sparse
+    bool sparse;
+    VAL* values;        // dense: indexed by key, with holes marked by a null pointer value
+    uint32_t* keys;     // sparse: JS_ELEMENTS_EMPTY for unused slots
+} js_elements_t;
+
+/* 2^32 - 1 is never an array index, so can mark unused slots */
+#define JS_ELEMENTS_EMPTY 0xffffffff
+
+js_elements_t* js_elements_new();
+bool js_elements_get(js_elements_t* elements, uint32_t index, VAL* value);
+void js_elements_put(js_elements_t* elements, uint32_t index, VAL value);
+bool js_elements_delete(js_elements_t* elements, uint32_t index);
+/* the indices present in ascending order. count is set to the number returned */
+uint32_t* js_elements_indices(js_elements_t* elements, uint32_t* count);
+void js_elements_sort_indices(uint32_t* indices, uint32_t count);
+/* moves *index on to the first index present at or after it. this takes a search
+   through every slot when the elements are sparse, so walking those in order is
+   better done with js_elements_indices */
+bool js_elements_next(js_elements_t* elements, uint32_t* index);
+
+#endif
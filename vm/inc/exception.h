@@ -11,6 +11,31 @@ typedef struct exception_handler {
     VAL exception;
 } js_exception_handler_t;
 
+struct js_image;
+
+typedef struct {
+    struct js_image* image;
+    uint32_t section;
+    uint32_t line;
+} js_stack_frame_t;
+
+/* the frames a thrown object has been unwound through, innermost first. only their
+   positions are recorded on the way, and the text isn't put together until someone
+   reads it */
+typedef struct js_stack_trace {
+    js_string_t* name;      // the thrown object's class, which heads the text
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t omitted;       // frames past the depth limit, which are only counted
+    js_stack_frame_t* frames;
+    js_string_t* string;    // NULL until built, and again whenever a frame is added
+} js_stack_trace_t;
+
+/* frames beyond depth are left out of stack traces */
+void js_set_stack_trace_depth(uint32_t depth);
+void js_stack_trace_push(js_stack_trace_t* trace, struct js_image* image, uint32_t section, uint32_t line);
+js_string_t* js_stack_trace_string(js_stack_trace_t* trace);
+
 void js_set_panic_handler(void(*panic_handler)(const char*, char*, int, char*));
 
 void js_panic_impl(const char* func, char* file, int line, char* fmt, ...)
@@ -31,16 +56,18 @@ void js_throw(VAL exception)
 void js_throw_message(struct js_vm* vm, char* message);
 bool js_try(void* state, void(*callback)(void*), VAL* exception);
 
+/* the handler lives in the enclosing function's stack frame, so trying costs no
+   allocation. try_block mustn't return or jump out of the JS_TRY */
 #define JS_TRY(try_block, ex_var, catch_block) do { \
-            js_exception_handler_t* __handler = js_alloc(sizeof(js_exception_handler_t)); \
-            __handler->previous = js_current_exception_handler(); \
-            js_set_exception_handler(__handler); \
-            if(!setjmp(__handler->env)) { \
+            js_exception_handler_t __handler; \
+            __handler.previous = js_current_exception_handler(); \
+            js_set_exception_handler(&__handler); \
+            if(!setjmp(__handler.env)) { \
                 try_block \
-                js_set_exception_handler(__handler->previous); \
+                js_set_exception_handler(__handler.previous); \
             } else { \
-                ex_var = __handler->exception; \
-                js_set_exception_handler(__handler->previous); \
+                ex_var = __handler.exception; \
+                js_set_exception_handler(__handler.previous); \
                 catch_block \
             } \
         } while(0)
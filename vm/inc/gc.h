@@ -3,23 +3,124 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
+
+typedef struct js_gc_region js_gc_region_t;
+
+/* pause_histogram[n] counts collections that took under 2^(n+16) cycles, with
+   the last bucket counting everything slower */
+#define JS_GC_PAUSE_BUCKETS 16
+
+/* allocations up to JS_GC_SLAB_CLASSES * 8 bytes are rounded up to a multiple of 8
+   and served from slabs of that object size */
+#define JS_GC_SLAB_CLASSES 8
+
+typedef struct {
+    size_t object_size;
+    size_t slabs;
+    size_t used; // objects
+    size_t capacity;
+} js_gc_slab_stats_t;
+
+typedef struct {
+    // where js_gc_memory_usage() is going:
+    size_t small_usage;
+    size_t large_usage;
+    size_t movable_usage;
+    // the large object space:
+    size_t large_objects;
+    size_t large_reserved;
+    // the movable space:
+    size_t movable_chunks;
+    size_t movable_size;
+    size_t movable_live;
+    uint32_t movable_fragmentation; // percentage of the movable space not holding live blocks
+    // slab occupancy, by object size:
+    js_gc_slab_stats_t slabs[JS_GC_SLAB_CLASSES];
+    // compaction:
+    uint32_t compactions;
+    size_t pinned_chunks; // during the last compaction
+    size_t bytes_evacuated;
+    // collections, with pauses measured in cpu cycles:
+    uint32_t collections;
+    uint64_t last_pause;
+    uint64_t max_pause;
+    uint64_t total_pause;
+    uint32_t pause_histogram[JS_GC_PAUSE_BUCKETS];
+    size_t marked_bytes; // by the last collection
+    uint64_t swept_bytes;
+    uint64_t allocated_bytes;
+} js_gc_stats_t;
+
+typedef struct {
+    char* file;
+    int line;
+    size_t count;
+    size_t bytes;
+} js_gc_site_t;
 
 #ifdef JS_GC_DEBUG
     void* js_alloc_impl(size_t sz, char* file, int line);
     void* js_alloc_no_pointer_impl(size_t sz, char* file, int line);
     void* js_realloc_impl(void* ptr, size_t sz, char* file, int line);
+    void* js_alloc_movable_impl(size_t sz, void* owner, char* file, int line);
     
     #define js_alloc(sz) js_alloc_impl(sz, __FILE__, __LINE__)
     #define js_alloc_no_pointer(sz) js_alloc_no_pointer_impl(sz, __FILE__, __LINE__)
     #define js_realloc(ptr, sz) js_realloc_impl(ptr, sz, __FILE__, __LINE__)
+    #define js_alloc_movable(sz, owner) js_alloc_movable_impl(sz, owner, __FILE__, __LINE__)
 #else
     void* js_alloc(size_t sz);
     void* js_alloc_no_pointer(size_t sz);
     void* js_realloc(void* ptr, size_t sz);
+    void* js_alloc_movable(size_t sz, void* owner);
 #endif
 void js_gc_init(void* stack_ptr);
 void js_gc_register_global(void* address, size_t length);
 void js_gc_run();
+void js_gc_finish_sweep();
+/* js_alloc_movable() memory must not contain pointers, and `owner` is the address
+   of the only pointer to it that may be relied upon. js_gc_compact() may move the
+   block and update *owner, unless something else is found referencing it. */
+void js_gc_compact();
+/* bytes in use, not counting dead allocations that are still waiting to be swept */
 size_t js_gc_memory_usage();
+void js_gc_get_stats(js_gc_stats_t* stats);
+/* calls callback(ptr, size, state) for every allocation that survived the last collection */
+void js_gc_walk(void(*callback)(void*, size_t, void*), void* state);
+bool js_gc_is_allocation(void* ptr);
+/* fills in up to `max` of the sites responsible for the most live memory and
+   returns how many there were. always 0 unless built with JS_GC_DEBUG */
+size_t js_gc_allocation_sites(js_gc_site_t* sites, size_t max);
+/* heap snapshots are streamed through write(data, length, state) in small pieces.
+   classify(ptr, size) returns an index into type_names for each allocation. the
+   format is described in gc.c */
+typedef void(*js_gc_snapshot_writer_t)(const void*, size_t, void*);
+typedef uint32_t(*js_gc_classifier_t)(void*, size_t);
+void js_gc_snapshot(js_gc_classifier_t classify, char** type_names, uint32_t type_count, js_gc_snapshot_writer_t write, void* state);
+
+js_gc_region_t* js_gc_region_new();
+/* new allocations are attributed to the current region. returns the previous one */
+js_gc_region_t* js_gc_set_region(js_gc_region_t* region);
+js_gc_region_t* js_gc_current_region();
+size_t js_gc_region_usage(js_gc_region_t* region);
+size_t js_gc_region_limit(js_gc_region_t* region);
+void js_gc_region_set_limit(js_gc_region_t* region, size_t limit);
+bool js_gc_region_over_limit(js_gc_region_t* region);
+/* called from inside js_alloc when an allocation takes a region over its limit */
+void js_gc_set_region_limit_handler(void(*handler)(js_gc_region_t*));
+/* stops enforcing the region's limit and frees it once nothing allocated in it is left */
+void js_gc_region_release(js_gc_region_t* region);
+
+/* handler(false) is called when memory usage first reaches `usage`, and handler(true)
+   when a collection finds at least `live` bytes still reachable, so collecting alone
+   won't bring usage back down. each threshold is cleared once it's reached, until set
+   again. the handler is called from inside the collector, so it must not allocate or
+   call into js - it should note the pressure and act on it later */
+void js_gc_set_pressure_threshold(size_t usage, size_t live);
+void js_gc_set_pressure_handler(void(*handler)(bool critical));
+/* returns a weak cell pointing at target. the cell is itself garbage collected, and
+   doesn't keep target alive - once target is collected, the cell reads NULL */
+void** js_gc_weak_new(void* target);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,34 @@
+#ifndef JS_HASHINDEX_H
+#define JS_HASHINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* the robin hood index behind js_proptable_t and js_valtable_t. it's a power of two
+   sized array of slots mapping hashes to positions in the table's own array of
+   entries. it never looks at keys itself - lookups call back into the table to
+   compare the key stored at a candidate entry */
+
+#define JS_HASHINDEX_EMPTY 0xffffffff
+#define JS_HASHINDEX_MIN_SIZE 8
+/* the index is kept at most 3/4 full */
+#define JS_HASHINDEX_CAPACITY(size) ((size) - (size) / 4)
+
+typedef struct {
+    uint32_t hash;
+    uint32_t entry;
+} js_hashindex_slot_t;
+
+/* returns true if `key` is the key stored at `entry` in `table` */
+typedef bool(*js_hashindex_match_t)(void* table, uint32_t entry, void* key);
+
+/* returns an index of `size` empty slots */
+js_hashindex_slot_t* js_hashindex_new(uint32_t size);
+void js_hashindex_clear(js_hashindex_slot_t* index, uint32_t mask);
+void js_hashindex_insert(js_hashindex_slot_t* index, uint32_t mask, uint32_t hash, uint32_t entry);
+/* returns the slot pointing at the matching entry, or JS_HASHINDEX_EMPTY. index may be NULL */
+uint32_t js_hashindex_find(js_hashindex_slot_t* index, uint32_t mask, uint32_t hash, js_hashindex_match_t match, void* table, void* key);
+/* empties a slot returned by js_hashindex_find */
+void js_hashindex_remove(js_hashindex_slot_t* index, uint32_t mask, uint32_t slot);
+
+#endif
@@ -6,10 +6,23 @@
 
 #define JS_FLAG_HAS_INNER_FUNCS (1)
 
+/* a try or catch block. an exception thrown by an instruction between start and end
+   goes to handler, and a return from inside it runs finally first. offsets are in
+   instructions, and a section's ranges are ordered innermost first */
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    uint32_t handler;
+    uint32_t finally;
+} js_exception_range_t;
+
 typedef struct {
     uint32_t instruction_count;
     uint32_t flags;
-    uint32_t var_count;
+    uint32_t var_count;     // variables in the scope, which only inner functions' variables need to be in
+    uint32_t local_count;   // variables kept on the stack for the duration of a call
+    uint32_t exception_range_count;
+    js_exception_range_t* exception_ranges;
     uint32_t* instructions;
 } js_section_t;
 
@@ -2,6 +2,7 @@
 #define JS_LIB_H
 
 #include "value.h"
+#include "valtable.h"
 
 typedef struct {
     VAL Function;
@@ -24,6 +25,12 @@ typedef struct {
     VAL ReferenceError_prototype;
     VAL TypeError;
     VAL TypeError_prototype;
+    VAL WeakRef;
+    VAL WeakRef_prototype;
+    VAL Map;
+    VAL Map_prototype;
+    VAL Set;
+    VAL Set_prototype;
 } js_lib_t;
 
 #include "vm.h"
@@ -41,6 +48,10 @@ VAL js_make_object(struct js_vm* vm);
 void js_lib_array_initialize(struct js_vm* vm);
 VAL js_make_array(struct js_vm* vm, uint32_t count, VAL* items);
 VAL* js_array_items(VAL array, uint32_t* count);
+/* like js_array_items, but hands back the array's own storage when it has no holes.
+   the array copies it before its next write, so the result can't change underneath
+   the caller, but the caller mustn't write to it either */
+VAL* js_array_borrow_items(VAL array, uint32_t* count);
 uint32_t js_array_length(VAL array);
 VAL js_array_get(VAL array, uint32_t idx);
 
@@ -66,4 +77,13 @@ void js_throw_error(VAL class, char* fmt, ...) __attribute__((noreturn));
 void js_lib_math_initialize(struct js_vm* vm);
 void js_lib_math_seed_random(int seed);
 
+/* WeakRef */
+void js_lib_weakref_initialize(struct js_vm* vm);
+
+/* Map and Set */
+void js_lib_map_initialize(struct js_vm* vm);
+VAL js_make_map(struct js_vm* vm);
+/* the table behind a Map or Set, for native code to use directly. a set's values are its keys */
+js_valtable_t* js_map_table(struct js_vm* vm, VAL map);
+
 #endif
\ No newline at end of file
@@ -2,10 +2,10 @@
 #define JS_OBJECT_H
 
 #include "value.h"
-#include "st.h"
+#include "proptable.h"
 
 int js_string_cmp(js_string_t* a, js_string_t* b);
-st_table* js_st_table_new();
 js_object_internal_methods_t* js_object_base_vtable();
+void js_object_lookup_cache_stats(uint64_t* hits, uint64_t* misses);
 
 #endif
\ No newline at end of file
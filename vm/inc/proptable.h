@@ -0,0 +1,60 @@
+#ifndef JS_PROPTABLE_H
+#define JS_PROPTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "string.h"
+#include "hashindex.h"
+
+/* an open addressed hash table from strings to pointers, used for object properties.
+   entries live inline in one array in insertion order, and a separate power of two
+   sized index (see hashindex.h) maps hashes to them */
+
+typedef struct {
+    js_string_t* key; // NULL for deleted entries
+    void* value;
+    uint32_t hash;
+} js_proptable_entry_t;
+
+typedef struct {
+    uint32_t count;     // live entries
+    uint32_t used;      // entries handed out, including deleted ones
+    uint32_t capacity;  // entries that fit before the table has to grow
+    uint32_t mask;      // index size - 1
+    js_proptable_entry_t* entries;
+    js_hashindex_slot_t* index;
+    bool prototype;     // set once the table's object has been looked through as a prototype
+    bool indexed;       // set once an array index key has been stored here rather than in elements
+    uint32_t compactions; // bumped whenever deleted entries are squeezed out
+} js_proptable_t;
+
+/* walks a table in insertion order while it's being changed, as for-in does. entries
+   deleted before they're reached are skipped, and none is returned twice. entries
+   added along the way are reached unless the table gets compacted first, after which
+   the iterator carries on through the entries as they were */
+typedef struct {
+    js_proptable_t* table;
+    js_proptable_entry_t* entries;
+    uint32_t used;
+    uint32_t position;
+    uint32_t compactions;
+} js_proptable_iter_t;
+
+/* bumped whenever a table marked as a prototype gains, loses or changes an entry,
+   which invalidates anything cached about prototype chains */
+extern uint32_t js_proptable_epoch;
+
+uint32_t js_string_hash(js_string_t* str);
+
+js_proptable_t* js_proptable_new();
+bool js_proptable_lookup(js_proptable_t* table, js_string_t* key, void** value);
+/* returns true if the key was already present */
+bool js_proptable_insert(js_proptable_t* table, js_string_t* key, void* value);
+bool js_proptable_delete(js_proptable_t* table, js_string_t* key);
+/* iterates in insertion order, with *cursor starting at 0. entries may be deleted
+   while iterating, but inserting can compact the table and move them around */
+bool js_proptable_next(js_proptable_t* table, uint32_t* cursor, js_string_t** key, void** value);
+void js_proptable_iter_init(js_proptable_t* table, js_proptable_iter_t* iter);
+bool js_proptable_iter_next(js_proptable_iter_t* iter, js_string_t** key, void** value);
+
+#endif
@@ -10,6 +10,12 @@ typedef struct js_scope {
     struct js_scope* parent;
     struct js_scope* global;
     struct js_vm* vm;
+    /* how many scopes up the global scope is */
+    uint32_t depth;
+    /* this scope followed by every scope above it, so display[n] is n scopes up. only
+       scopes that functions close over have one - the rest are reached through their
+       parent's */
+    struct js_scope** display;
     union {
         VAL global_object;
         struct {
@@ -24,7 +30,9 @@ js_scope_t* js_scope_make_global(struct js_vm* vm, VAL object);
 VAL js_scope_get_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes);
 void js_scope_set_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes, VAL value);
 bool js_scope_has_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes);
-js_scope_t* js_scope_close(js_scope_t* scope, VAL callee);
+js_scope_t* js_scope_close(js_scope_t* scope, VAL callee, uint32_t var_count);
+/* for calls to functions with no inner functions, whose scopes can't be closed over
+   and so can live on the stack */
 js_scope_t* js_scope_close_placement(js_scope_t* new_scope, js_scope_t* scope, VAL callee, uint32_t var_count, VAL* vars);
 
 VAL js_scope_get_global_var(js_scope_t* scope, js_string_t* name);
@@ -8,12 +8,40 @@
 typedef struct {
     uint32_t length;
     char* buff;
+    uint32_t hash; // cached by js_string_hash, 0 if it hasn't been computed yet
+    bool number_cached; // whether js_number_parse has worked out number yet
+    double number;
 } js_string_t;
 
+/* builds a string up piece by piece. the buffer grows geometrically, and can start
+   out as storage on the caller's stack so short results only allocate once */
+typedef struct {
+    uint32_t length;
+    uint32_t capacity;
+    char* buff;
+    bool on_heap;
+} js_string_builder_t;
+
+/* storage may be NULL, with size 0 */
+void js_string_builder_init(js_string_builder_t* builder, char* storage, uint32_t size);
+void js_string_builder_append(js_string_builder_t* builder, char* str, uint32_t length);
+void js_string_builder_append_uint32(js_string_builder_t* builder, uint32_t value, uint32_t base);
+void js_string_builder_append_int32(js_string_builder_t* builder, int32_t value);
+/* understands %s, %d, %i, %u, %x, %c and %% */
+void js_string_builder_format(js_string_builder_t* builder, char* fmt, ...);
+void js_string_builder_vformat(js_string_builder_t* builder, char* fmt, va_list args);
+/* returns the built string, allocated to exactly its length */
+js_string_t* js_string_builder_finish(js_string_builder_t* builder);
+
 js_string_t* js_string_concat(js_string_t* a, js_string_t* b);
+/* where needle first occurs in haystack. an empty needle is found at 0 */
 bool js_string_index_of(js_string_t* haystack, js_string_t* needle, uint32_t* index);
 bool js_string_eq(js_string_t* a, js_string_t* b);
 js_string_t* js_string_from_double(double d);
+/* true if str is the canonical form of an array index, ie. 0 to 2^32 - 2 */
+bool js_string_to_index(js_string_t* str, uint32_t* index);
+/* the string for an array index, which is shared rather than fresh for small ones */
+js_string_t* js_string_from_index(uint32_t index);
 js_string_t* js_string_format(char* fmt, ...);
 js_string_t* js_string_vformat(char* fmt, va_list args);
 
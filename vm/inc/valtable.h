@@ -0,0 +1,41 @@
+#ifndef JS_VALTABLE_H
+#define JS_VALTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "value.h"
+#include "hashindex.h"
+
+/* an open addressed hash table keyed on any value, backing Map and Set. keys are
+   compared the way SameValueZero does: objects by identity, strings by contents
+   and numbers by value, with NaN equal to itself and -0 equal to +0. it's laid out
+   like js_proptable_t - entries in insertion order, plus the same robin hood index */
+
+typedef struct {
+    VAL key;        // a null pointer value for deleted entries
+    VAL value;
+    uint32_t hash;
+} js_valtable_entry_t;
+
+typedef struct {
+    uint32_t count;     // live entries
+    uint32_t used;      // entries handed out, including deleted ones
+    uint32_t capacity;  // entries that fit before the table has to grow
+    uint32_t mask;      // index size - 1
+    uint32_t iterating; // while non-zero, entries are never moved
+    js_valtable_entry_t* entries;
+    js_hashindex_slot_t* index;
+} js_valtable_t;
+
+js_valtable_t* js_valtable_new();
+bool js_valtable_lookup(js_valtable_t* table, VAL key, VAL* value);
+/* returns true if the key was already present */
+bool js_valtable_insert(js_valtable_t* table, VAL key, VAL value);
+bool js_valtable_delete(js_valtable_t* table, VAL key);
+void js_valtable_clear(js_valtable_t* table);
+/* iterates in insertion order without allocating, with *cursor starting at 0.
+   entries may be deleted while iterating, and entries inserted meanwhile are
+   reached as long as table->iterating is held up for the duration */
+bool js_valtable_next(js_valtable_t* table, uint32_t* cursor, VAL* key, VAL* value);
+
+#endif
@@ -2,9 +2,11 @@
 #define JS_VALUE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "string.h"
-#include "st.h"
+#include "proptable.h"
+#include "gc.h"
 
 typedef enum {
     JS_T_NULL,
@@ -46,14 +48,17 @@ typedef struct {
 } js_property_descriptor_t;
 
 struct js_object_internal_methods;
+struct js_elements;
+struct js_stack_trace;
 
 typedef struct {
     struct js_object_internal_methods* vtable;
     VAL prototype;
     VAL class;
-    js_string_t* stack_trace;
+    struct js_stack_trace* stack_trace; // NULL until the object is first thrown
     void* state;
-    st_table* properties;
+    js_proptable_t* properties;
+    struct js_elements* elements; // NULL until something is stored under an index
 } js_object_t;
 
 typedef struct {
@@ -83,6 +88,13 @@ typedef struct {
     };
 } js_function_t;
 
+/* how far enumerating an object's index keys has got, zeroed to start with */
+typedef struct {
+    uint32_t* indices;  // the keys left to go, for objects that can't just walk their storage in order
+    uint32_t count;
+    uint32_t position;
+} js_index_cursor_t;
+
 typedef struct js_object_internal_methods {
     /* all objects should have these implemented: */
     VAL                         (*get)                  (js_value_t*, js_string_t*);
@@ -95,8 +107,39 @@ typedef struct js_object_internal_methods {
     VAL                         (*default_value)        (js_value_t*, js_type_t);
     bool                        (*define_own_property)  (js_value_t*, js_string_t*, js_property_descriptor_t*);
     js_string_t**               (*keys)                 (js_value_t*, uint32_t* count);
+    /* optional fast paths for array index keys, which are otherwise passed to get and put as strings: */
+    VAL                         (*get_index)            (js_value_t*, uint32_t);
+    void                        (*put_index)            (js_value_t*, uint32_t, VAL);
+    /* optional lazy enumeration of array index keys: moves the index on to the first own
+       enumerable index key at or after it, returning false once there are none */
+    bool                        (*next_index)           (js_value_t*, uint32_t*, js_index_cursor_t*);
 } js_object_internal_methods_t;
 
+/* a for-in loop's place in an object's own enumerable keys - index keys in ascending
+   order, then everything else in insertion order. key strings are only made as keys
+   are reached. keys deleted before they're reached are skipped, no key is visited
+   twice, and keys added along the way may or may not be visited */
+typedef struct {
+    js_value_t* object;
+    bool indices_done;
+    uint32_t index;     // where to look for the next index key from
+    js_index_cursor_t index_cursor;
+    js_proptable_iter_t names;
+} js_enumerator_t;
+
+typedef struct {
+    char* name;
+    size_t count;
+    size_t bytes;
+} js_census_entry_t;
+
+/* index of the census entry for allocations that aren't recognisably values */
+#define JS_CENSUS_OTHER (JS_T_BOOLEAN_OBJECT + 1)
+
+/* a NaN boxed null pointer, which no value ever is. tables store it to mark holes and
+   deleted entries */
+#define JS_VALUE_HOLE 0xfffa000000000000ull
+
 VAL js_value_make_pointer(js_value_t* ptr);
 VAL js_value_make_double(double num);
 VAL js_value_make_string(char* buff, uint32_t len);
@@ -133,11 +176,16 @@ bool js_eq(struct js_vm* vm, VAL a, VAL b);
 
 VAL js_object_get(VAL obj, js_string_t* prop);
 void js_object_put(VAL obj, js_string_t* prop, VAL value);
+VAL js_object_get_index(VAL obj, uint32_t index);
+void js_object_put_index(VAL obj, uint32_t index, VAL value);
 bool js_object_define_own_property(VAL obj, js_string_t* prop, js_property_descriptor_t* descr);
 bool js_object_has_property(VAL obj, js_string_t* prop);
 VAL js_object_default_value(VAL obj, js_type_t preferred_type);
 bool js_object_delete(VAL obj, js_string_t* prop);
 js_string_t** js_object_keys(VAL obj, uint32_t* count);
+void js_object_enumerate(VAL obj, js_enumerator_t* enumerator);
+/* returns NULL once there are no keys left */
+js_string_t* js_enumerator_next(js_enumerator_t* enumerator);
 
 void js_object_put_accessor(struct js_vm* vm, VAL obj, char* prop, js_native_callback_t get, js_native_callback_t set);
 
@@ -145,5 +193,18 @@ VAL js_call(VAL fn, VAL this, uint32_t argc, VAL* argv);
 VAL js_construct(VAL fn, uint32_t argc, VAL* argv);
 
 void js_scan_args(struct js_vm* vm, uint32_t argc, VAL* argv, char* fmt, ...);
+/* single arguments to a native function, without going through a format string.
+   missing arguments are undefined, and the typed ones throw a TypeError if the
+   argument isn't of that type */
+VAL js_arg(uint32_t argc, VAL* argv, uint32_t index);
+VAL js_arg_number(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index);
+VAL js_arg_string(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index);
+VAL js_arg_boolean(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index);
+uint32_t js_arg_uint32(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index);
+
+/* breaks the live heap down by type. census needs room for JS_CENSUS_OTHER + 1 entries */
+void js_value_census(js_census_entry_t* census);
+/* writes a snapshot of the heap with allocations typed the same way as the census */
+void js_value_heap_snapshot(js_gc_snapshot_writer_t write, void* state);
 
 #endif
\ No newline at end of file
@@ -6,15 +6,24 @@
 #include "image.h"
 #include "value.h"
 #include "lib.h"
+#include "gc.h"
 
 #define VM_CYCLES_PER_COLLECTION 50000
 
 typedef struct js_vm {
     js_scope_t* global_scope;
     js_lib_t lib;
+    js_gc_region_t* region;
 } js_vm_t;
 
+/* counters shared by every vm */
+typedef struct {
+    uint64_t lookup_cache_hits;
+    uint64_t lookup_cache_misses;
+} js_vm_stats_t;
+
 js_vm_t* js_vm_new();
+void js_vm_get_stats(js_vm_stats_t* stats);
 void js_vm_set_stack_limit(void* stack_limit);
 VAL js_vm_exec(js_vm_t* vm, js_image_t* image, uint32_t section, js_scope_t* scope, VAL this, uint32_t argc, VAL* argv);
 
@@ -73,6 +82,8 @@ enum js_opcode {
     JS_OP_DEBUGGER      = 51,
     JS_OP_INSTANCEOF    = 52,
     JS_OP_NEGATE        = 53,
+    // try, poptry and popcatch are no longer emitted: try blocks are found through
+    // their section's exception ranges instead
     JS_OP_TRY           = 54,
     JS_OP_POPTRY        = 55,
     JS_OP_CATCH         = 56,
@@ -90,8 +101,16 @@ enum js_opcode {
     JS_OP_JEND          = 68,
     JS_OP_ENUMPOP       = 69,
     JS_OP_EQ            = 70,
+    JS_OP_PUSHLOCAL     = 71,
+    JS_OP_SETLOCAL      = 72,
+    JS_OP_ARGLEN        = 73,
+    JS_OP_ARGINDEX      = 74,
 };
 
+/* setcallee, setarg, arguments and catch store to either a variable in the scope or,
+   with this bit set on the index, a stack local */
+#define JS_VAR_LOCAL 0x80000000
+
 typedef struct {
     char* name;
     enum {
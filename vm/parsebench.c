@@ -0,0 +1,304 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include "gc.h"
+#include "value.h"
+#include "lib.h"
+#include "bench.h"
+
+/* checks string to number conversion against the C library's strtod and compares
+   its speed with the conversion it replaced, which summed digits into a double */
+
+#define RANDOM_STRINGS 300000
+#define TIMED_CONVERSIONS 1000000
+
+static bool is_char_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static double old_number_parse(js_string_t* str)
+{
+    double number = 0;
+    double frac = 0.1;
+    int exponent = 0;
+    bool neg = false, negexp = false;
+    uint32_t i;
+    for(i = 0; i < str->length; i++) {
+        if(!is_char_whitespace(str->buff[i])) {
+            break;
+        }
+    }
+    if(i == str->length) {
+        return NAN;
+    }
+    if(str->buff[i] == '-') {
+        neg = true;
+        i++;
+    }
+    if(str->buff[i] == '+') {
+        i++;
+    }
+    if(i == str->length) {
+        return NAN;
+    }
+    for(; i < str->length; i++) {
+        if(str->buff[i] >= '0' && str->buff[i] <= '9') {
+            number *= 10;
+            number += str->buff[i] - '0';
+        } else {
+            break;
+        }
+    }
+    if(i == str->length) {
+        return (neg ? -1.0 : 1.0) * number;
+    }
+    if(str->buff[i] == '.') {
+        i++;
+        for(; i < str->length; i++) {
+            if(str->buff[i] >= '0' && str->buff[i] <= '9') {
+                number += (str->buff[i] - '0') * frac;
+                frac /= 10.0;
+            } else {
+                break;
+            }
+        }
+    }
+    if(i < str->length && (str->buff[i] == 'e' || str->buff[i] == 'E')) {
+        i++;
+        if(i < str->length) {
+            if(str->buff[i] == '+') {
+                i++;
+            } else if(str->buff[i] == '-') {
+                negexp = true;
+                i++;
+            }
+        }
+        for(; i < str->length; i++) {
+            exponent = exponent * 10 + str->buff[i] - '0';
+        }
+        if(negexp) {
+            exponent = -exponent;
+        }
+        while(exponent > 0) {
+            number *= 10.0;
+            exponent--;
+        }
+        while(exponent < 0) {
+            number /= 10.0;
+            exponent++;
+        }
+    }
+    return (neg ? -1.0 : 1.0) * number;
+}
+
+static uint64_t random_state = 88172645463325252ull;
+
+static uint64_t random_bits()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static double random_double()
+{
+    union {
+        uint64_t i;
+        double d;
+    } u;
+    do {
+        u.i = random_bits() & 0x7fffffffffffffffull;
+    } while(!isfinite(u.d));
+    return u.d;
+}
+
+static uint64_t double_bits(double d)
+{
+    union {
+        double d;
+        uint64_t i;
+    } u;
+    u.d = d;
+    return u.i;
+}
+
+/* a fresh string each time, so nothing is cached */
+static double parse(char* buff)
+{
+    js_string_t str;
+    memset(&str, 0, sizeof(str));
+    str.buff = buff;
+    str.length = strlen(buff);
+    return js_number_parse(&str);
+}
+
+/* one failure is enough to tell something's off, so only the first few are shown */
+static uint32_t failures;
+
+static void check(char* buff, double expected)
+{
+    double got = parse(buff);
+    if(double_bits(got) != double_bits(expected) && !(got != got && expected != expected)) {
+        if(failures++ < 10) {
+            printf("  \"%.60s\": got %.17g, expected %.17g\n", buff, got, expected);
+        }
+    }
+}
+
+static void check_strtod(char* buff)
+{
+    check(buff, strtod(buff, NULL));
+}
+
+/* the exact decimal expansion of the point halfway between d and the next double
+   up, which is where the rounding is hardest to get right */
+static void check_halfway(double d, char* suffix)
+{
+    char buff[1200];
+    long double halfway = ((long double)d + (long double)nextafter(d, INFINITY)) / 2;
+    sprintf(buff, "%.800Le", halfway);
+    if(*suffix) {
+        // nudge it just above halfway with digits far past any double's precision:
+        char* e = strchr(buff, 'e');
+        char exponent[16];
+        strcpy(exponent, e);
+        strcpy(e, suffix);
+        strcat(buff, exponent);
+    }
+    check_strtod(buff);
+}
+
+static void accuracy()
+{
+    static char* syntax[][2] = {
+        { "", "0" }, { "   ", "0" }, { " 42 ", "42" }, { "\t-7\n", "-7" }, { "+3", "3" },
+        { "-0", "-0" }, { "1.", "1" }, { ".5", "0.5" }, { ".", "nan" }, { "-", "nan" },
+        { "1e", "nan" }, { "1e+", "nan" }, { "e5", "nan" }, { "1x", "nan" }, { "1 2", "nan" },
+        { "0x1F", "31" }, { "0X10", "16" }, { "0x", "nan" }, { "-0x10", "nan" }, { "0xg", "nan" },
+        { "Infinity", "inf" }, { "-Infinity", "-inf" }, { "+Infinity", "inf" }, { "infinity", "nan" },
+        { "1e400", "inf" }, { "1e-400", "0" }, { "0e999999999", "0" }, { "00012", "12" },
+        { "1.5e3", "1500" }, { "4294967296", "4294967296" }, { "123456789", "123456789" },
+    };
+    static char* hard[] = {
+        "0.1", "0.3", "1e23", "8.98846567431158e307", "1.7976931348623157e308",
+        "1.7976931348623158e308", "1.7976931348623159e308", "2.2250738585072011e-308",
+        "2.2250738585072012e-308", "4.9406564584124654e-324", "2.4703282292062327e-324",
+        "2.4703282292062328e-324", "9007199254740993", "9007199254740992.5",
+        "123456789012345678901234567890", "0.000000000000000000000000000001234",
+        "3.14159265358979323846264338327950288419716939937510582097494459",
+        "7.3177701707893310e+15", "5e-324", "1e-323", "1e308", "1e-308", "1e22", "1e-22",
+    };
+    char buff[64];
+    uint32_t i, j;
+    clock_t start = clock();
+    failures = 0;
+    for(i = 0; i < sizeof(syntax) / sizeof(syntax[0]); i++) {
+        check(syntax[i][0], strtod(syntax[i][1], NULL));
+    }
+    for(i = 0; i < sizeof(hard) / sizeof(hard[0]); i++) {
+        check_strtod(hard[i]);
+    }
+    for(i = 0; i < RANDOM_STRINGS; i++) {
+        double d = random_double();
+        sprintf(buff, "%.17g", d);
+        check(buff, d);
+        sprintf(buff, "%.*g", (int)(random_bits() % 17) + 1, d);
+        check_strtod(buff);
+        // random digits with a random exponent:
+        uint32_t length = random_bits() % 30 + 1;
+        for(j = 0; j < length; j++) {
+            buff[j] = '0' + random_bits() % 10;
+        }
+        sprintf(buff + length, "e%d", (int)(random_bits() % 700) - 350);
+        check_strtod(buff);
+    }
+    for(i = 0; i < 2000; i++) {
+        double d = random_double();
+        check_halfway(d, "");
+        check_halfway(d, "000000000000000000000000000000000000000000001");
+    }
+    printf("%-34s %8.2fms %u failures\n", "accuracy", elapsed(start), failures);
+}
+
+static char strings[TIMED_CONVERSIONS / 1000][32];
+
+static void throughput(char* name, double (*convert)(js_string_t*), char* fmt, double (*make)(uint32_t))
+{
+    js_string_t str;
+    uint32_t i, wrong = 0;
+    double ms;
+    clock_t start;
+    for(i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        sprintf(strings[i], fmt, make(i));
+    }
+    start = clock();
+    for(i = 0; i < TIMED_CONVERSIONS; i++) {
+        str.buff = strings[i % (sizeof(strings) / sizeof(strings[0]))];
+        str.length = strlen(str.buff);
+        str.number_cached = false;
+        convert(&str);
+    }
+    ms = elapsed(start);
+    for(i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        str.buff = strings[i];
+        str.length = strlen(str.buff);
+        str.number_cached = false;
+        wrong += double_bits(convert(&str)) != double_bits(strtod(str.buff, NULL));
+    }
+    printf("%-34s %8.2fns per conversion, %u of %u wrong\n", name, ms * 1000000 / TIMED_CONVERSIONS,
+        wrong, (uint32_t)(sizeof(strings) / sizeof(strings[0])));
+}
+
+static double make_integer(uint32_t i)
+{
+    return i * 7919 % 100000;
+}
+
+static double make_decimal(uint32_t i)
+{
+    return i / 64.0 + 0.25;
+}
+
+static double make_random(uint32_t i)
+{
+    return random_double();
+}
+
+/* the same string over and over, as when a string is compared with numbers in a loop */
+static void cached_throughput(char* name)
+{
+    js_string_t str;
+    uint32_t i;
+    double sum = 0;
+    clock_t start;
+    memset(&str, 0, sizeof(str));
+    str.buff = "3.14159265358979";
+    str.length = strlen(str.buff);
+    start = clock();
+    for(i = 0; i < TIMED_CONVERSIONS; i++) {
+        sum += js_number_parse(&str);
+    }
+    printf("%-34s %8.2fns per conversion (sum %g)\n", name,
+        elapsed(start) * 1000000 / TIMED_CONVERSIONS, sum);
+}
+
+int main()
+{
+    uint32_t dummy;
+    js_gc_init(&dummy);
+    accuracy();
+    throughput("integers, old", old_number_parse, "%.0f", make_integer);
+    throughput("integers, new", js_number_parse, "%.0f", make_integer);
+    throughput("short decimals, old", old_number_parse, "%g", make_decimal);
+    throughput("short decimals, new", js_number_parse, "%g", make_decimal);
+    throughput("17 digits, old", old_number_parse, "%.17g", make_random);
+    throughput("17 digits, new", js_number_parse, "%.17g", make_random);
+    cached_throughput("repeated string, new");
+    return 0;
+}
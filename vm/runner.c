@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "image.h"
 #include "vm.h"
 #include "value.h"
@@ -33,7 +34,64 @@ static VAL console_log(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* a
     return js_value_undefined();
 }
 
-int main()
+static void dump_vm_stats()
+{
+    js_vm_stats_t stats;
+    uint64_t lookups;
+    js_vm_get_stats(&stats);
+    lookups = stats.lookup_cache_hits + stats.lookup_cache_misses;
+    fprintf(stderr, "vm: prototype lookup cache %llu hits, %llu misses (%.1f%%)\n",
+        (unsigned long long)stats.lookup_cache_hits, (unsigned long long)stats.lookup_cache_misses,
+        lookups ? 100.0 * stats.lookup_cache_hits / lookups : 0.0);
+}
+
+static void dump_gc_stats()
+{
+    js_gc_stats_t stats;
+    js_census_entry_t census[JS_CENSUS_OTHER + 1];
+    js_gc_site_t sites[20];
+    size_t site_count, i;
+    
+    js_gc_get_stats(&stats);
+    fprintf(stderr, "gc: %u collections, pause last %llu max %llu total %llu cycles\n",
+        (uint32_t)stats.collections, (unsigned long long)stats.last_pause,
+        (unsigned long long)stats.max_pause, (unsigned long long)stats.total_pause);
+    fprintf(stderr, "gc: %llu bytes allocated, %llu marked, %llu swept\n",
+        (unsigned long long)stats.allocated_bytes, (unsigned long long)stats.marked_bytes,
+        (unsigned long long)stats.swept_bytes);
+    fprintf(stderr, "gc: pause histogram:");
+    for(i = 0; i < JS_GC_PAUSE_BUCKETS; i++) {
+        fprintf(stderr, " %u", (uint32_t)stats.pause_histogram[i]);
+    }
+    fprintf(stderr, "\n");
+    for(i = 0; i < JS_GC_SLAB_CLASSES; i++) {
+        if(stats.slabs[i].slabs) {
+            fprintf(stderr, "gc: slab %2u bytes: %u slabs, %u of %u objects used\n", (uint32_t)stats.slabs[i].object_size,
+                (uint32_t)stats.slabs[i].slabs, (uint32_t)stats.slabs[i].used, (uint32_t)stats.slabs[i].capacity);
+        }
+    }
+    
+    js_value_census(census);
+    for(i = 0; i <= JS_CENSUS_OTHER; i++) {
+        if(census[i].count) {
+            fprintf(stderr, "gc: live %-16s %8u objects %10u bytes\n", census[i].name,
+                (uint32_t)census[i].count, (uint32_t)census[i].bytes);
+        }
+    }
+    
+    site_count = js_gc_allocation_sites(sites, 20);
+    for(i = 0; i < site_count; i++) {
+        fprintf(stderr, "gc: site %s:%d %8u allocations %10u bytes\n", sites[i].file, sites[i].line,
+            (uint32_t)sites[i].count, (uint32_t)sites[i].bytes);
+    }
+}
+
+static void write_snapshot(const void* data, size_t length, void* state)
+{
+    fwrite(data, 1, length, state);
+}
+
+int main(int argc, char** argv)
 {
     uint32_t dummy;
     uint32_t len;
@@ -41,6 +99,21 @@ int main()
     js_image_t* image;
     js_vm_t* vm;
     VAL exception;
+    int show_gc_stats = 0;
+    char* snapshot_path = NULL;
+    FILE* snapshot;
+    int i;
+    
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-s") == 0) {
+            show_gc_stats = 1;
+        } else if(strcmp(argv[i], "-h") == 0 && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-s] [-h snapshot-file] < image\n", argv[0]);
+            return 1;
+        }
+    }
     
     js_gc_init(&dummy);
     buff = read_until_eof(stdin, &len);
@@ -58,5 +131,18 @@ int main()
         exit(-1);
     });
     
+    if(show_gc_stats) {
+        dump_vm_stats();
+        dump_gc_stats();
+    }
+    if(snapshot_path) {
+        if(!(snapshot = fopen(snapshot_path, "wb"))) {
+            fprintf(stderr, "could not open %s\n", snapshot_path);
+            return 1;
+        }
+        js_value_heap_snapshot(write_snapshot, snapshot);
+        fclose(snapshot);
+    }
+    
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <stdlib.h>
+#include <string.h>
+#include "elements.h"
+#include "gc.h"
+
+#define ELEMENTS_MIN_CAPACITY 8
+/* indices below this are always stored densely, however few there are */
+#define ELEMENTS_DENSE_LIMIT 64
+
+js_elements_t* js_elements_new()
+{
+    return js_alloc(sizeof(js_elements_t));
+}
+
+static uint32_t home_slot(js_elements_t* elements, uint32_t index)
+{
+    index *= 0x9e3779b1;
+    return (index ^ (index >> 15)) & (elements->capacity - 1);
+}
+
+static uint32_t find_slot(js_elements_t* elements, uint32_t index)
+{
+    uint32_t slot = home_slot(elements, index);
+    while(elements->keys[slot] != JS_ELEMENTS_EMPTY) {
+        if(elements->keys[slot] == index) {
+            return slot;
+        }
+        slot = (slot + 1) & (elements->capacity - 1);
+    }
+    return JS_ELEMENTS_EMPTY;
+}
+
+static void sparse_insert(js_elements_t* elements, uint32_t index, VAL value)
+{
+    uint32_t slot = home_slot(elements, index);
+    while(elements->keys[slot] != JS_ELEMENTS_EMPTY) {
+        slot = (slot + 1) & (elements->capacity - 1);
+    }
+    elements->keys[slot] = index;
+    elements->values[slot] = value;
+}
+
+/* rehashes everything into a sparse table with the given number of slots */
+static void make_sparse(js_elements_t* elements, uint32_t capacity)
+{
+    uint32_t* old_keys = elements->keys;
+    VAL* old_values = elements->values;
+    uint32_t old_capacity = elements->capacity;
+    bool was_sparse = elements->sparse;
+    uint32_t i;
+    elements->sparse = true;
+    elements->capacity = capacity;
+    elements->keys = js_alloc_no_pointer(sizeof(uint32_t) * capacity);
+    memset(elements->keys, 0xff, sizeof(uint32_t) * capacity);
+    elements->values = js_alloc(sizeof(VAL) * capacity);
+    for(i = 0; i < old_capacity; i++) {
+        if(was_sparse) {
+            if(old_keys[i] != JS_ELEMENTS_EMPTY) {
+                sparse_insert(elements, old_keys[i], old_values[i]);
+            }
+        } else if(old_values[i].i != JS_VALUE_HOLE) {
+            sparse_insert(elements, i, old_values[i]);
+        }
+    }
+}
+
+bool js_elements_get(js_elements_t* elements, uint32_t index, VAL* value)
+{
+    uint32_t slot;
+    if(elements == NULL || elements->count == 0) {
+        return false;
+    }
+    if(!elements->sparse) {
+        if(index >= elements->capacity || elements->values[index].i == JS_VALUE_HOLE) {
+            return false;
+        }
+        *value = elements->values[index];
+        return true;
+    }
+    slot = find_slot(elements, index);
+    if(slot == JS_ELEMENTS_EMPTY) {
+        return false;
+    }
+    *value = elements->values[slot];
+    return true;
+}
+
+void js_elements_put(js_elements_t* elements, uint32_t index, VAL value)
+{
+    uint32_t slot, capacity, i;
+    if(!elements->sparse) {
+        if(index < elements->capacity) {
+            if(elements->values[index].i == JS_VALUE_HOLE) {
+                elements->count++;
+            }
+            elements->values[index] = value;
+            return;
+        }
+        if(index < ELEMENTS_DENSE_LIMIT || (elements->count + 1) * 4 > index) {
+            // at least a quarter of the vector would be in use, so grow it:
+            capacity = elements->capacity < ELEMENTS_MIN_CAPACITY ? ELEMENTS_MIN_CAPACITY : elements->capacity;
+            while(capacity <= index) {
+                capacity *= 2;
+            }
+            elements->values = js_realloc(elements->values, sizeof(VAL) * capacity);
+            for(i = elements->capacity; i < capacity; i++) {
+                elements->values[i].i = JS_VALUE_HOLE;
+            }
+            elements->capacity = capacity;
+            elements->values[index] = value;
+            elements->count++;
+            return;
+        }
+        capacity = ELEMENTS_MIN_CAPACITY;
+        while(capacity * 3 < (elements->count + 1) * 4) {
+            capacity *= 2;
+        }
+        make_sparse(elements, capacity);
+    }
+    slot = find_slot(elements, index);
+    if(slot != JS_ELEMENTS_EMPTY) {
+        elements->values[slot] = value;
+        return;
+    }
+    if((elements->count + 1) * 4 > elements->capacity * 3) {
+        make_sparse(elements, elements->capacity * 2);
+    }
+    sparse_insert(elements, index, value);
+    elements->count++;
+}
+
+bool js_elements_delete(js_elements_t* elements, uint32_t index)
+{
+    uint32_t slot, next, home, mask;
+    if(elements == NULL || elements->count == 0) {
+        return false;
+    }
+    if(!elements->sparse) {
+        if(index >= elements->capacity || elements->values[index].i == JS_VALUE_HOLE) {
+            return false;
+        }
+        elements->values[index].i = JS_VALUE_HOLE;
+        elements->count--;
+        return true;
+    }
+    slot = find_slot(elements, index);
+    if(slot == JS_ELEMENTS_EMPTY) {
+        return false;
+    }
+    // close the gap by moving back anything later in the run that could live here:
+    mask = elements->capacity - 1;
+    next = slot;
+    while(true) {
+        next = (next + 1) & mask;
+        if(elements->keys[next] == JS_ELEMENTS_EMPTY) {
+            break;
+        }
+        home = home_slot(elements, elements->keys[next]);
+        if(((next - home) & mask) >= ((next - slot) & mask)) {
+            elements->keys[slot] = elements->keys[next];
+            elements->values[slot] = elements->values[next];
+            slot = next;
+        }
+    }
+    elements->keys[slot] = JS_ELEMENTS_EMPTY;
+    elements->values[slot].i = JS_VALUE_HOLE;
+    elements->count--;
+    return true;
+}
+
+void js_elements_sort_indices(uint32_t* indices, uint32_t count)
+{
+    uint32_t gap, i, j, tmp;
+    // shellsort, as there's no qsort in the kernel's libc:
+    for(gap = count / 2; gap > 0; gap = gap == 2 ? 1 : gap * 5 / 11) {
+        for(i = gap; i < count; i++) {
+            tmp = indices[i];
+            for(j = i; j >= gap && indices[j - gap] > tmp; j -= gap) {
+                indices[j] = indices[j - gap];
+            }
+            indices[j] = tmp;
+        }
+    }
+}
+
+uint32_t* js_elements_indices(js_elements_t* elements, uint32_t* count)
+{
+    uint32_t* indices;
+    uint32_t i;
+    *count = 0;
+    if(elements == NULL || elements->count == 0) {
+        return NULL;
+    }
+    indices = js_alloc_no_pointer(sizeof(uint32_t) * elements->count);
+    for(i = 0; i < elements->capacity; i++) {
+        if(elements->sparse ? elements->keys[i] != JS_ELEMENTS_EMPTY : elements->values[i].i != JS_VALUE_HOLE) {
+            indices[(*count)++] = elements->sparse ? elements->keys[i] : i;
+        }
+    }
+    if(elements->sparse) {
+        js_elements_sort_indices(indices, *count);
+    }
+    return indices;
+}
+
+bool js_elements_next(js_elements_t* elements, uint32_t* index)
+{
+    uint32_t i, found = JS_ELEMENTS_EMPTY;
+    if(elements == NULL) {
+        return false;
+    }
+    if(!elements->sparse) {
+        for(i = *index; i < elements->capacity; i++) {
+            if(elements->values[i].i != JS_VALUE_HOLE) {
+                *index = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    for(i = 0; i < elements->capacity; i++) {
+        if(elements->keys[i] >= *index && elements->keys[i] < found) {
+            found = elements->keys[i];
+        }
+    }
+    if(found == JS_ELEMENTS_EMPTY) {
+        return false;
+    }
+    *index = found;
+    return true;
+}
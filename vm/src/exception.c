@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include "exception.h"
+#include "image.h"
 #include "vm.h"
 #include "gc.h"
 
@@ -42,15 +43,61 @@ void js_panic_impl(const char* func, char* file, int line, char* fmt, ...)
     exit(-1);
 }
 
+static uint32_t stack_trace_depth = 64;
+
+void js_set_stack_trace_depth(uint32_t depth)
+{
+    stack_trace_depth = depth;
+}
+
+void js_stack_trace_push(js_stack_trace_t* trace, struct js_image* image, uint32_t section, uint32_t line)
+{
+    if(trace->count >= stack_trace_depth) {
+        trace->omitted++;
+        return;
+    }
+    if(trace->count == trace->capacity) {
+        trace->capacity = trace->capacity ? trace->capacity * 2 : 4;
+        trace->frames = js_realloc(trace->frames, sizeof(js_stack_frame_t) * trace->capacity);
+    }
+    trace->frames[trace->count].image = image;
+    trace->frames[trace->count].section = section;
+    trace->frames[trace->count].line = line;
+    trace->count++;
+    trace->string = NULL;
+}
+
+js_string_t* js_stack_trace_string(js_stack_trace_t* trace)
+{
+    js_string_builder_t builder;
+    uint32_t i;
+    if(trace->string) {
+        return trace->string;
+    }
+    js_string_builder_init(&builder, NULL, 0);
+    js_string_builder_append(&builder, trace->name->buff, trace->name->length);
+    for(i = 0; i < trace->count; i++) {
+        js_image_t* image = trace->frames[i].image;
+        js_string_builder_format(&builder, "\n    at %s:%u", image->strings[image->name]->buff, trace->frames[i].line);
+    }
+    if(trace->omitted) {
+        js_string_builder_format(&builder, "\n    ... %u more", trace->omitted);
+    }
+    trace->string = js_string_builder_finish(&builder);
+    return trace->string;
+}
+
 void js_throw(VAL exception)
 {
     if(js_value_is_object(exception) && !js_value_get_pointer(exception)->object.stack_trace) {
         VAL class = js_value_get_pointer(exception)->object.class;
+        js_stack_trace_t* trace = js_alloc(sizeof(js_stack_trace_t));
         if(js_value_get_type(class) == JS_T_FUNCTION && ((js_function_t*)js_value_get_pointer(class))->name) {
-            js_value_get_pointer(exception)->object.stack_trace = ((js_function_t*)js_value_get_pointer(class))->name;
+            trace->name = ((js_function_t*)js_value_get_pointer(class))->name;
         } else {
-            js_value_get_pointer(exception)->object.stack_trace = js_cstring("(anonymous)");
+            trace->name = js_cstring("(anonymous)");
         }
+        js_value_get_pointer(exception)->object.stack_trace = trace;
     }
     if(js_current_exception_handler() == NULL) {
         js_panic("exception thrown with no handler");
@@ -66,18 +113,18 @@ void js_throw_message(js_vm_t* vm, char* message)
 
 bool js_try(void* state, void(*callback)(void*), VAL* exception)
 {
-    js_exception_handler_t* handler = js_alloc(sizeof(js_exception_handler_t));
-    handler->previous = js_current_exception_handler();
-    js_set_exception_handler(handler);
-    handler->exception = js_value_undefined();
-    if(setjmp(handler->env) == 0) {
+    js_exception_handler_t handler;
+    handler.previous = js_current_exception_handler();
+    js_set_exception_handler(&handler);
+    handler.exception = js_value_undefined();
+    if(setjmp(handler.env) == 0) {
         callback(state);
-        js_set_exception_handler(handler->previous);
+        js_set_exception_handler(handler.previous);
         return true;
     } else {
         /* exception was thrown */
-        *exception = handler->exception;
-        js_set_exception_handler(handler->previous);
+        *exception = handler.exception;
+        js_set_exception_handler(handler.previous);
         return false;
     }
 }
\ No newline at end of file
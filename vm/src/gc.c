@@ -1,11 +1,55 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <setjmp.h>
 #include "gc.h"
+#include "proptable.h"
 #include "exception.h"
 
+#ifndef JSOS
+    // hosted builds get memalign from the system's malloc
+    #include <malloc.h>
+#endif
+
 #define ALLOC_MAX_BUCKETS (65536 + 45)
 
+/* how many buckets js_alloc will sweep at most before falling back to malloc */
+#define SWEEP_BUCKETS_PER_ALLOC 32
+
+#ifdef JS_GC_POISON
+    #define POISON_WORD 0xdeadbeef
+#endif
+
+/* movable blocks are packed into chunks of this size, unless they're bigger */
+#define MOVABLE_CHUNK_SIZE (64 * 1024)
+/* chunks at least this full (as a percentage) aren't worth evacuating */
+#define MOVABLE_EVACUATE_OCCUPANCY 75
+#define MOVABLE_ALIGN(sz) (((sz) + 7) & ~(size_t)7)
+
+/* allocations at least this big go in the large object space. their memory is
+   reserved in whole pages so they can grow a little without being reallocated */
+#define LARGE_OBJECT_SIZE (16 * 1024)
+#define LARGE_PAGE_SIZE 4096
+#define LARGE_ROUND(sz) (((sz) + LARGE_PAGE_SIZE - 1) & ~(size_t)(LARGE_PAGE_SIZE - 1))
+
+/* small allocations - values, property table entries, the gc's own bookkeeping -
+   come out of slabs: page aligned runs of same sized objects, which have no per
+   object header and whose slab can be found by rounding an object's address down */
+#define SLAB_SIZE 4096
+#define SLAB_GRANULE 8
+#define SLAB_MAX_OBJECT (JS_GC_SLAB_CLASSES * SLAB_GRANULE)
+#define SLAB_CLASS(sz) ((sz) ? ((sz) - 1) / SLAB_GRANULE : 0)
+
+/* a region is a slice of the heap that allocations are attributed to, usually
+   one per vm. regions don't own memory - everything still lives in the one shared
+   heap and is collected by the one mark phase - but they account for it and can
+   enforce a limit. a released region is freed once its last allocation dies */
+struct js_gc_region {
+    size_t usage;
+    size_t limit;
+    bool released;
+};
+
 static uint16_t pointer_hash(void* ptr)
 {
     return (2654435761ul * (intptr_t)ptr) % ALLOC_MAX_BUCKETS;
@@ -20,8 +64,12 @@ typedef struct allocation {
         char* file;
         int line;
     #endif
+    js_gc_region_t* region;
     bool flag;
     bool no_pointer;
+    bool movable;
+    bool large;
+    bool slab;
 } alloc_t;
 
 typedef struct global {
@@ -36,6 +84,179 @@ static alloc_t* allocs[ALLOC_MAX_BUCKETS];
 static global_t* globals;
 static intptr_t* stack_top;
 static size_t memory_usage;
+static size_t movable_usage;
+static size_t large_usage;
+static size_t large_reserved;
+static size_t large_objects;
+
+static js_gc_region_t* current_region;
+static void(*region_limit_handler)(js_gc_region_t*);
+
+static void(*pressure_handler)(bool);
+static size_t pressure_threshold = (size_t)-1;
+static size_t critical_threshold = (size_t)-1;
+
+/* weak cells are no_pointer allocations holding a single pointer, which is cleared
+   once whatever it points at has been collected */
+typedef struct weak {
+    void** cell;
+    struct weak* next;
+} weak_t;
+
+static weak_t* weak_cells;
+
+/* sweeping is done lazily - after marking, buckets below sweep_cursor have
+   been swept and buckets at or above it may still hold dead allocations */
+static uint32_t sweep_cursor = ALLOC_MAX_BUCKETS;
+/* bytes found live by the last mark, and bytes held by dead allocations the
+   sweep hasn't got to yet, which js_gc_memory_usage() leaves out */
+static size_t marked_bytes;
+static size_t unswept_bytes;
+
+/* the movable space. blocks from js_alloc_movable have a single owner slot which
+   holds the one precise pointer to them, and are bump allocated out of chunks.
+   js_gc_compact() copies the survivors of sparse chunks into fresh ones and hands
+   the old chunks back to malloc whole. any other (ambiguous) reference into a
+   chunk - from the stack, a global or a heap word - pins the entire chunk */
+typedef struct chunk {
+    struct chunk* next;
+    struct chunk* prev;
+    size_t size;
+    size_t used;
+    size_t live;
+    bool pinned;
+} chunk_t;
+
+typedef struct block {
+    chunk_t* chunk;
+    void** owner; // NULL once the block is dead
+    size_t size;
+    bool owner_seen;
+} block_t;
+
+#define CHUNK_HEADER_SIZE MOVABLE_ALIGN(sizeof(chunk_t))
+#define BLOCK_HEADER_SIZE MOVABLE_ALIGN(sizeof(block_t))
+#define CHUNK_DATA(chunk) ((char*)(chunk) + CHUNK_HEADER_SIZE)
+#define BLOCK_HEADER(ptr) ((block_t*)((char*)(ptr) - BLOCK_HEADER_SIZE))
+#define BLOCK_SPAN(sz) (BLOCK_HEADER_SIZE + MOVABLE_ALIGN(sz))
+
+static chunk_t* chunks;
+static chunk_t* current_chunk;
+static intptr_t chunks_low;
+static intptr_t chunks_high;
+
+static uint32_t compactions;
+static size_t pinned_chunks;
+static size_t bytes_evacuated;
+
+typedef struct slab {
+    struct slab* next;
+    struct slab* prev;
+    void* free_list;
+    uint16_t object_size;
+    uint16_t capacity;
+    uint16_t used;
+    uint16_t bump; // objects past this have never been handed out
+} slab_t;
+
+#define SLAB_HEADER_SIZE MOVABLE_ALIGN(sizeof(slab_t))
+#define SLAB_OF(ptr) ((slab_t*)((intptr_t)(ptr) & ~(intptr_t)(SLAB_SIZE - 1)))
+
+typedef struct {
+    slab_t* partial; // slabs with at least one free object
+    size_t slabs;
+    size_t used;
+} slab_class_t;
+
+static slab_class_t slab_classes[JS_GC_SLAB_CLASSES];
+
+static uint32_t collections;
+static uint64_t last_pause;
+static uint64_t max_pause;
+static uint64_t total_pause;
+static uint32_t pause_histogram[JS_GC_PAUSE_BUCKETS];
+static uint64_t swept_bytes;
+static uint64_t allocated_bytes;
+
+static uint64_t js_gc_timestamp()
+{
+    #if defined(__i386__) || defined(__x86_64__)
+        uint32_t lo, hi;
+        __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+        return ((uint64_t)hi << 32) | lo;
+    #else
+        return 0;
+    #endif
+}
+
+static void* slab_alloc(size_t sz)
+{
+    slab_class_t* class = &slab_classes[SLAB_CLASS(sz)];
+    slab_t* slab = class->partial;
+    void* ptr;
+    if(slab == NULL) {
+        slab = memalign(SLAB_SIZE, SLAB_SIZE);
+        if(slab == NULL) {
+            return NULL;
+        }
+        slab->next = NULL;
+        slab->prev = NULL;
+        slab->free_list = NULL;
+        slab->object_size = (SLAB_CLASS(sz) + 1) * SLAB_GRANULE;
+        slab->capacity = (SLAB_SIZE - SLAB_HEADER_SIZE) / slab->object_size;
+        slab->used = 0;
+        slab->bump = 0;
+        class->partial = slab;
+        class->slabs++;
+    }
+    if(slab->free_list) {
+        ptr = slab->free_list;
+        slab->free_list = *(void**)ptr;
+    } else {
+        ptr = (char*)slab + SLAB_HEADER_SIZE + slab->bump++ * slab->object_size;
+    }
+    class->used++;
+    if(++slab->used == slab->capacity) {
+        // full slabs drop off the partial list until something in them is freed
+        class->partial = slab->next;
+        if(slab->next) {
+            slab->next->prev = NULL;
+        }
+        slab->next = NULL;
+    }
+    return ptr;
+}
+
+static void slab_free(void* ptr)
+{
+    slab_t* slab = SLAB_OF(ptr);
+    slab_class_t* class = &slab_classes[SLAB_CLASS(slab->object_size)];
+    *(void**)ptr = slab->free_list;
+    slab->free_list = ptr;
+    class->used--;
+    if(slab->used-- == slab->capacity) {
+        slab->prev = NULL;
+        slab->next = class->partial;
+        if(slab->next) {
+            slab->next->prev = slab;
+        }
+        class->partial = slab;
+    }
+    if(slab->used == 0 && (slab->prev || slab->next)) {
+        // hand empty slabs back, but keep the last one around so a class that's
+        // hovering around a slab boundary doesn't keep allocating and freeing pages
+        if(slab->prev) {
+            slab->prev->next = slab->next;
+        } else {
+            class->partial = slab->next;
+        }
+        if(slab->next) {
+            slab->next->prev = slab->prev;
+        }
+        class->slabs--;
+        free(slab);
+    }
+}
 
 static alloc_t* allocs_lookup(void* ptr)
 {
@@ -53,12 +274,16 @@ static alloc_t* allocs_lookup(void* ptr)
 static alloc_t* allocs_insert(void* ptr, size_t size)
 {
     uint16_t h = pointer_hash(ptr);
-    alloc_t* alloc = malloc(sizeof(alloc_t));
+    alloc_t* alloc = slab_alloc(sizeof(alloc_t));
     alloc->ptr = ptr;
     alloc->flag = current_mark_flag;
     alloc->size = size;
     alloc->next = allocs[h];
     alloc->no_pointer = false;
+    alloc->movable = false;
+    alloc->large = false;
+    alloc->slab = false;
+    alloc->region = current_region;
     if(alloc->next) {
         alloc->next->prev = alloc;
     }
@@ -67,6 +292,143 @@ static alloc_t* allocs_insert(void* ptr, size_t size)
     return alloc;
 }
 
+/* keeps the usage counters up to date when an allocation changes size. a size of
+   zero means the allocation is being created or destroyed */
+static void js_gc_account(alloc_t* alloc, size_t old_size, size_t new_size)
+{
+    memory_usage = memory_usage - old_size + new_size;
+    if(new_size > old_size) {
+        allocated_bytes += new_size - old_size;
+        if(memory_usage - unswept_bytes >= pressure_threshold && pressure_handler) {
+            // the threshold only fires once, until the handler sets it again
+            pressure_threshold = (size_t)-1;
+            pressure_handler(false);
+        }
+    }
+    if(alloc->large) {
+        large_usage = large_usage - old_size + new_size;
+        large_reserved = large_reserved - LARGE_ROUND(old_size) + LARGE_ROUND(new_size);
+        if(old_size == 0) {
+            large_objects++;
+        } else if(new_size == 0) {
+            large_objects--;
+        }
+    } else if(alloc->movable) {
+        movable_usage = movable_usage - old_size + new_size;
+    }
+    if(alloc->region) {
+        alloc->region->usage = alloc->region->usage - old_size + new_size;
+        if(new_size > old_size && js_gc_region_over_limit(alloc->region) && region_limit_handler) {
+            region_limit_handler(alloc->region);
+        }
+    }
+}
+
+static void allocs_move(alloc_t* alloc, void* new_ptr)
+{
+    uint16_t new_hash = pointer_hash(new_ptr);
+    // unlink this alloc from its old bucket:
+    if(alloc->prev == NULL) {
+        allocs[pointer_hash(alloc->ptr)] = alloc->next;
+    } else {
+        alloc->prev->next = alloc->next;
+    }
+    if(alloc->next) {
+        alloc->next->prev = alloc->prev;
+    }
+    alloc->ptr = new_ptr;
+    // add to the start of its new bucket:
+    alloc->next = allocs[new_hash];
+    if(alloc->next) {
+        alloc->next->prev = alloc;
+    }
+    alloc->prev = NULL;
+    allocs[new_hash] = alloc;
+}
+
+static chunk_t* chunk_new(size_t size)
+{
+    chunk_t* chunk = malloc(CHUNK_HEADER_SIZE + size);
+    if(chunk == NULL) {
+        return NULL;
+    }
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->live = 0;
+    chunk->pinned = false;
+    chunk->prev = NULL;
+    chunk->next = chunks;
+    if(chunk->next) {
+        chunk->next->prev = chunk;
+    }
+    chunks = chunk;
+    if(chunks_low == 0 || (intptr_t)chunk < chunks_low) {
+        chunks_low = (intptr_t)chunk;
+    }
+    if((intptr_t)CHUNK_DATA(chunk) + (intptr_t)size > chunks_high) {
+        chunks_high = (intptr_t)CHUNK_DATA(chunk) + (intptr_t)size;
+    }
+    return chunk;
+}
+
+static void chunk_delete(chunk_t* chunk)
+{
+    if(chunk->prev == NULL) {
+        chunks = chunk->next;
+    } else {
+        chunk->prev->next = chunk->next;
+    }
+    if(chunk->next) {
+        chunk->next->prev = chunk->prev;
+    }
+    if(chunk == current_chunk) {
+        current_chunk = NULL;
+    }
+    free(chunk);
+}
+
+static void* movable_alloc(size_t sz, void* owner)
+{
+    size_t span = BLOCK_SPAN(sz);
+    chunk_t* chunk;
+    block_t* block;
+    if(span > MOVABLE_CHUNK_SIZE) {
+        // too big to share a chunk with anything else, so this is a large object:
+        chunk = chunk_new(LARGE_ROUND(span));
+    } else {
+        if(current_chunk == NULL || current_chunk->used + span > current_chunk->size) {
+            current_chunk = chunk_new(MOVABLE_CHUNK_SIZE);
+        }
+        chunk = current_chunk;
+    }
+    if(chunk == NULL) {
+        return NULL;
+    }
+    block = (block_t*)(CHUNK_DATA(chunk) + chunk->used);
+    block->chunk = chunk;
+    block->owner = owner;
+    block->size = sz;
+    block->owner_seen = false;
+    chunk->used += span;
+    chunk->live += span;
+    return (char*)block + BLOCK_HEADER_SIZE;
+}
+
+static void movable_free(void* ptr)
+{
+    block_t* block = BLOCK_HEADER(ptr);
+    chunk_t* chunk = block->chunk;
+    block->owner = NULL;
+    chunk->live -= BLOCK_SPAN(block->size);
+    if(chunk->live == 0) {
+        if(chunk == current_chunk) {
+            chunk->used = 0;
+        } else {
+            chunk_delete(chunk);
+        }
+    }
+}
+
 static void allocs_delete_alloc(alloc_t* alloc, uint16_t h)
 {    
     if(alloc->prev == NULL) {
@@ -77,40 +439,123 @@ static void allocs_delete_alloc(alloc_t* alloc, uint16_t h)
     if(alloc->next) {
         alloc->next->prev = alloc->prev;
     }
-    memset(alloc->ptr, 0, alloc->size);
-    free(alloc->ptr);
-    memory_usage -= alloc->size;
-    free(alloc);
+    #ifdef JS_GC_POISON
+        // fill dead memory with a recognisable pattern so use-after-free bugs stand out:
+        {
+            uint32_t* word = alloc->ptr;
+            size_t i;
+            for(i = 0; i < alloc->size / sizeof(uint32_t); i++) {
+                word[i] = POISON_WORD;
+            }
+            memset((char*)alloc->ptr + i * sizeof(uint32_t), 0xef, alloc->size % sizeof(uint32_t));
+        }
+    #endif
+    if(alloc->movable) {
+        movable_free(alloc->ptr);
+    } else if(alloc->slab) {
+        slab_free(alloc->ptr);
+    } else {
+        free(alloc->ptr);
+    }
+    js_gc_account(alloc, alloc->size, 0);
+    if(alloc->region && alloc->region->released && alloc->region->usage == 0) {
+        free(alloc->region);
+    }
+    slab_free(alloc);
 }
 
-#ifdef JS_GC_DEBUG
-void* js_alloc_impl(size_t sz, char* file, int line)
-#else
-void* js_alloc(size_t sz)
-#endif
+static size_t js_gc_sweep_bucket(uint32_t bucket)
+{
+    alloc_t* alloc = allocs[bucket];
+    alloc_t* next;
+    size_t freed = 0;
+    while(alloc) {
+        next = alloc->next;
+        if(alloc->flag != current_mark_flag) {
+            freed += alloc->size;
+            allocs_delete_alloc(alloc, bucket);
+        }
+        alloc = next;
+    }
+    unswept_bytes -= freed;
+    swept_bytes += freed;
+    return freed;
+}
+
+/* sweeps buckets until either `wanted` bytes have been freed or the per-call
+   budget runs out. returns true if there's nothing left to sweep */
+static bool js_gc_sweep_step(size_t wanted)
+{
+    uint32_t budget = SWEEP_BUCKETS_PER_ALLOC;
+    size_t freed = 0;
+    while(sweep_cursor < ALLOC_MAX_BUCKETS && budget > 0 && freed < wanted) {
+        freed += js_gc_sweep_bucket(sweep_cursor++);
+        budget--;
+    }
+    return sweep_cursor == ALLOC_MAX_BUCKETS;
+}
+
+static void* js_gc_reserve(size_t sz, void* owner)
+{
+    if(owner) {
+        return movable_alloc(sz, owner);
+    }
+    if(sz >= LARGE_OBJECT_SIZE) {
+        return malloc(LARGE_ROUND(sz));
+    }
+    if(sz <= SLAB_MAX_OBJECT) {
+        return slab_alloc(sz);
+    }
+    return malloc(sz);
+}
+
+static void* js_gc_allocate(size_t sz, void* owner)
 {
     void* ptr;
-    alloc_t* alloc;
     if(stack_top == NULL) {
         js_panic("js_alloc() called before js_gc_init()");
     }
-    ptr = malloc(sz);
+    // pay for this allocation by sweeping a little of the heap left over from the last collection:
+    js_gc_sweep_step(sz);
+    ptr = js_gc_reserve(sz, owner);
     if(ptr == NULL) {
-        // allocation failed, so run a gc and attempt to free up some space
+        // allocation failed, so finish off the pending sweep and try again
+        js_gc_finish_sweep();
+        ptr = js_gc_reserve(sz, owner);
+    }
+    if(ptr == NULL) {
+        // still no luck, so run a full gc and attempt to free up some space
         js_gc_run();
-        ptr = malloc(sz);
+        js_gc_finish_sweep();
+        ptr = js_gc_reserve(sz, owner);
+    }
+    if(ptr == NULL) {
+        // there may be enough free memory, just not in one piece. compacting the
+        // movable space hands whole chunks back to malloc to be coalesced:
+        js_gc_compact();
+        ptr = js_gc_reserve(sz, owner);
         if(ptr == NULL) {
             js_panic("malloc(%u) failed - out of memory!", sz);
         }
     }
-    memory_usage += sz;
     memset(ptr, 0, sz);
-    alloc = allocs_insert(ptr, sz);
+    return ptr;
+}
+
+#ifdef JS_GC_DEBUG
+void* js_alloc_impl(size_t sz, char* file, int line)
+#else
+void* js_alloc(size_t sz)
+#endif
+{
+    void* ptr = js_gc_allocate(sz, NULL);
+    alloc_t* alloc = allocs_insert(ptr, sz);
+    alloc->large = sz >= LARGE_OBJECT_SIZE;
+    alloc->slab = sz <= SLAB_MAX_OBJECT;
+    js_gc_account(alloc, 0, sz);
     #ifdef JS_GC_DEBUG
         alloc->file = file;
         alloc->line = line;
-    #else
-        (void)alloc;
     #endif
     return ptr;
 }
@@ -131,6 +576,88 @@ void* js_alloc_no_pointer(size_t sz)
     return ptr;    
 }
 
+#ifdef JS_GC_DEBUG
+void* js_alloc_movable_impl(size_t sz, void* owner, char* file, int line)
+#else
+void* js_alloc_movable(size_t sz, void* owner)
+#endif
+{
+    void* ptr;
+    alloc_t* alloc;
+    if(owner == NULL) {
+        js_panic("js_alloc_movable() called without an owner");
+    }
+    ptr = js_gc_allocate(sz, owner);
+    alloc = allocs_insert(ptr, sz);
+    alloc->no_pointer = true;
+    alloc->movable = true;
+    js_gc_account(alloc, 0, sz);
+    #ifdef JS_GC_DEBUG
+        alloc->file = file;
+        alloc->line = line;
+    #endif
+    return ptr;
+}
+
+/* grows or shrinks a movable block without moving it. only the last block in a
+   chunk can do this */
+static bool movable_resize(alloc_t* alloc, size_t sz)
+{
+    block_t* block = BLOCK_HEADER(alloc->ptr);
+    chunk_t* chunk = block->chunk;
+    size_t new_used = chunk->used - BLOCK_SPAN(block->size) + BLOCK_SPAN(sz);
+    if((char*)block + BLOCK_SPAN(block->size) != CHUNK_DATA(chunk) + chunk->used || new_used > chunk->size) {
+        return false;
+    }
+    if(sz > block->size) {
+        memset((char*)alloc->ptr + block->size, 0, sz - block->size);
+    }
+    chunk->live = chunk->live - BLOCK_SPAN(block->size) + BLOCK_SPAN(sz);
+    chunk->used = new_used;
+    js_gc_account(alloc, alloc->size, sz);
+    block->size = sz;
+    alloc->size = sz;
+    return true;
+}
+
+/* a block with a chunk all to itself can grow by reallocating the whole chunk,
+   which malloc can often do in place if the memory after it is free */
+static bool movable_grow_alone(alloc_t* alloc, size_t sz)
+{
+    block_t* block = BLOCK_HEADER(alloc->ptr);
+    chunk_t* chunk = block->chunk;
+    chunk_t* new_chunk;
+    size_t size = LARGE_ROUND(BLOCK_SPAN(sz));
+    if(chunk == current_chunk || (char*)block != CHUNK_DATA(chunk) || chunk->used != BLOCK_SPAN(block->size)) {
+        return false;
+    }
+    new_chunk = realloc(chunk, CHUNK_HEADER_SIZE + size);
+    if(new_chunk == NULL) {
+        return false;
+    }
+    new_chunk->size = size;
+    if(new_chunk != chunk) {
+        if(new_chunk->prev == NULL) {
+            chunks = new_chunk;
+        } else {
+            new_chunk->prev->next = new_chunk;
+        }
+        if(new_chunk->next) {
+            new_chunk->next->prev = new_chunk;
+        }
+        if((intptr_t)new_chunk < chunks_low) {
+            chunks_low = (intptr_t)new_chunk;
+        }
+        block = (block_t*)CHUNK_DATA(new_chunk);
+        block->chunk = new_chunk;
+        allocs_move(alloc, (char*)block + BLOCK_HEADER_SIZE);
+    }
+    if((intptr_t)CHUNK_DATA(new_chunk) + (intptr_t)size > chunks_high) {
+        chunks_high = (intptr_t)CHUNK_DATA(new_chunk) + (intptr_t)size;
+    }
+    return movable_resize(alloc, sz);
+}
+
 #ifdef JS_GC_DEBUG
 void* js_realloc_impl(void* ptr, size_t sz, char* file, int line)
 #else
@@ -139,7 +666,6 @@ void* js_realloc(void* ptr, size_t sz)
 {
     alloc_t* alloc = allocs_lookup(ptr);
     void* new_ptr;
-    uint16_t new_hash;
     if(alloc == NULL) {
         #ifdef JS_GC_DEBUG
             return js_alloc_impl(sz, file, line);
@@ -147,33 +673,60 @@ void* js_realloc(void* ptr, size_t sz)
             return js_alloc(sz);
         #endif
     }
-    new_ptr = realloc(ptr, sz);
-    if(new_ptr == ptr) {
-        alloc->size = sz;
+    if(alloc->movable) {
+        // movable blocks live inside chunks, so they're resized by hand rather than by realloc:
+        if(movable_resize(alloc, sz)) {
+            return ptr;
+        }
+        if(movable_grow_alone(alloc, sz)) {
+            return alloc->ptr;
+        }
+        #ifdef JS_GC_DEBUG
+            new_ptr = js_alloc_movable_impl(sz, BLOCK_HEADER(ptr)->owner, file, line);
+        #else
+            new_ptr = js_alloc_movable(sz, BLOCK_HEADER(ptr)->owner);
+        #endif
+        memcpy(new_ptr, ptr, sz < alloc->size ? sz : alloc->size);
+        allocs_delete_alloc(alloc, pointer_hash(ptr));
         return new_ptr;
     }
-    
-    // pointer has changed, so unlink this alloc from its bucket:    
-    new_hash = pointer_hash(new_ptr);
-    if(alloc->prev == NULL) {
-        allocs[pointer_hash(ptr)] = alloc->next;
-    } else {
-        alloc->prev->next = alloc->next;
+    if(alloc->large && sz >= LARGE_OBJECT_SIZE && LARGE_ROUND(sz) == LARGE_ROUND(alloc->size)) {
+        // still fits in the pages it already has:
+        js_gc_account(alloc, alloc->size, sz);
+        alloc->size = sz;
+        return ptr;
     }
-    if(alloc->next) {
-        alloc->next->prev = alloc->prev;
+    if(alloc->slab && sz <= SLAB_MAX_OBJECT && SLAB_CLASS(sz) == SLAB_CLASS(alloc->size)) {
+        // still fits in its slab object:
+        js_gc_account(alloc, alloc->size, sz);
+        alloc->size = sz;
+        return ptr;
     }
-    // change the pointer and size:
-    alloc->ptr = new_ptr;
+    if(alloc->slab || sz <= SLAB_MAX_OBJECT) {
+        // slab objects can't be handed to realloc, so moving in or out of a slab is a copy:
+        new_ptr = js_gc_allocate(sz, NULL);
+        memcpy(new_ptr, ptr, sz < alloc->size ? sz : alloc->size);
+        if(alloc->slab) {
+            slab_free(ptr);
+        } else {
+            free(ptr);
+        }
+    } else {
+        new_ptr = realloc(ptr, sz >= LARGE_OBJECT_SIZE ? LARGE_ROUND(sz) : sz);
+        if(new_ptr == NULL) {
+            js_panic("realloc(%u) failed - out of memory!", sz);
+        }
+    }
+    // it may have moved in or out of the large object space:
+    js_gc_account(alloc, alloc->size, 0);
+    alloc->large = sz >= LARGE_OBJECT_SIZE;
+    alloc->slab = sz <= SLAB_MAX_OBJECT;
+    js_gc_account(alloc, 0, sz);
     alloc->size = sz;
-    // add to the start of its new bucket:
-    alloc->next = allocs[new_hash];
-    if(alloc->next) {
-        alloc->next->prev = alloc;
+    if(new_ptr != ptr) {
+        // pointer has changed, so move this alloc to its new bucket:
+        allocs_move(alloc, new_ptr);
     }
-    alloc->prev = NULL;
-    allocs[new_hash] = alloc;
-    // and return the pointer to the new allocation:
     return new_ptr;
 }
 
@@ -194,7 +747,131 @@ void js_gc_register_global(void* address, size_t length)
 
 size_t js_gc_memory_usage()
 {
-    return memory_usage;
+    return memory_usage - unswept_bytes;
+}
+
+js_gc_region_t* js_gc_region_new()
+{
+    js_gc_region_t* region = malloc(sizeof(js_gc_region_t));
+    if(region == NULL) {
+        js_panic("couldn't allocate gc region");
+    }
+    region->usage = 0;
+    region->limit = 0;
+    region->released = false;
+    return region;
+}
+
+js_gc_region_t* js_gc_set_region(js_gc_region_t* region)
+{
+    js_gc_region_t* previous = current_region;
+    current_region = region;
+    return previous;
+}
+
+js_gc_region_t* js_gc_current_region()
+{
+    return current_region;
+}
+
+size_t js_gc_region_usage(js_gc_region_t* region)
+{
+    return region->usage;
+}
+
+size_t js_gc_region_limit(js_gc_region_t* region)
+{
+    return region->limit;
+}
+
+void js_gc_region_set_limit(js_gc_region_t* region, size_t limit)
+{
+    region->limit = limit;
+}
+
+bool js_gc_region_over_limit(js_gc_region_t* region)
+{
+    return region->limit && region->usage > region->limit;
+}
+
+void js_gc_set_region_limit_handler(void(*handler)(js_gc_region_t*))
+{
+    region_limit_handler = handler;
+}
+
+void js_gc_region_release(js_gc_region_t* region)
+{
+    // allocations can't be freed in bulk, because anything in the region might
+    // still be referenced from elsewhere. they're left to the collector instead:
+    region->released = true;
+    region->limit = 0;
+    if(region->usage == 0 && region != current_region) {
+        free(region);
+    }
+}
+
+void js_gc_set_pressure_threshold(size_t usage, size_t live)
+{
+    pressure_threshold = usage;
+    critical_threshold = live;
+}
+
+void js_gc_set_pressure_handler(void(*handler)(bool))
+{
+    pressure_handler = handler;
+}
+
+void** js_gc_weak_new(void* target)
+{
+    weak_t* weak = malloc(sizeof(weak_t));
+    void** cell;
+    if(weak == NULL) {
+        js_panic("malloc(%u) failed - out of memory!", sizeof(weak_t));
+    }
+    cell = js_alloc_no_pointer(sizeof(void*));
+    *cell = target;
+    weak->cell = cell;
+    weak->next = weak_cells;
+    weak_cells = weak;
+    return cell;
+}
+
+void js_gc_get_stats(js_gc_stats_t* stats)
+{
+    chunk_t* chunk;
+    uint32_t i;
+    memset(stats, 0, sizeof(*stats));
+    for(chunk = chunks; chunk; chunk = chunk->next) {
+        stats->movable_chunks++;
+        stats->movable_size += chunk->size;
+        stats->movable_live += chunk->live;
+    }
+    // (this avoids 64 bit division, which would need libgcc on i386)
+    if(stats->movable_size >= 100 && stats->movable_live / (stats->movable_size / 100) < 100) {
+        stats->movable_fragmentation = 100 - stats->movable_live / (stats->movable_size / 100);
+    }
+    stats->small_usage = memory_usage - movable_usage - large_usage;
+    stats->large_usage = large_usage;
+    stats->large_reserved = large_reserved;
+    stats->large_objects = large_objects;
+    stats->movable_usage = movable_usage;
+    stats->collections = collections;
+    stats->last_pause = last_pause;
+    stats->max_pause = max_pause;
+    stats->total_pause = total_pause;
+    memcpy(stats->pause_histogram, pause_histogram, sizeof(pause_histogram));
+    stats->marked_bytes = marked_bytes;
+    stats->swept_bytes = swept_bytes;
+    stats->allocated_bytes = allocated_bytes;
+    for(i = 0; i < JS_GC_SLAB_CLASSES; i++) {
+        stats->slabs[i].object_size = (i + 1) * SLAB_GRANULE;
+        stats->slabs[i].slabs = slab_classes[i].slabs;
+        stats->slabs[i].used = slab_classes[i].used;
+        stats->slabs[i].capacity = slab_classes[i].slabs * ((SLAB_SIZE - SLAB_HEADER_SIZE) / ((i + 1) * SLAB_GRANULE));
+    }
+    stats->compactions = compactions;
+    stats->pinned_chunks = pinned_chunks;
+    stats->bytes_evacuated = bytes_evacuated;
 }
 
 static void js_gc_mark_allocation(alloc_t* alloc)
@@ -205,11 +882,16 @@ static void js_gc_mark_allocation(alloc_t* alloc)
         return;
     }
     alloc->flag = current_mark_flag;
+    marked_bytes += alloc->size;
     if(alloc->no_pointer) {
         return;
     }
     while((intptr_t)ptrptr < (intptr_t)((intptr_t)alloc->ptr + alloc->size)) {
-        suballoc = allocs_lookup(*ptrptr);
+        intptr_t p = (intptr_t)*ptrptr;
+        if(sizeof(intptr_t) == 8) {
+            p &= 0x7ffffffffffful;
+        }
+        suballoc = allocs_lookup((intptr_t*)p);
         if(suballoc) {
             js_gc_mark_allocation(suballoc);
         }
@@ -253,34 +935,491 @@ NOINLINE static void js_gc_mark()
     }
 }
 
-NOINLINE static void js_gc_sweep()
+/* runs between marking and sweeping, so anything unmarked is about to be freed */
+static void js_gc_clear_weak_cells()
 {
-    uint32_t i;
+    weak_t** link = &weak_cells;
+    weak_t* weak;
     alloc_t* alloc;
-    alloc_t* next;
-    for(i = 0; i < ALLOC_MAX_BUCKETS; i++) {
-        alloc = allocs[i];
-        while(alloc) {
-            next = alloc->next;
-            if(alloc->flag != current_mark_flag) {
-                allocs_delete_alloc(alloc, pointer_hash(alloc->ptr));
+    while((weak = *link)) {
+        alloc = allocs_lookup(weak->cell);
+        if(alloc == NULL || alloc->flag != current_mark_flag) {
+            // the cell itself is dead
+            *link = weak->next;
+            free(weak);
+            continue;
+        }
+        if(*weak->cell) {
+            alloc = allocs_lookup(*weak->cell);
+            if(alloc == NULL || alloc->flag != current_mark_flag) {
+                *weak->cell = NULL;
             }
-            alloc = next;
         }
+        link = &weak->next;
+    }
+}
+
+void js_gc_finish_sweep()
+{
+    while(sweep_cursor < ALLOC_MAX_BUCKETS) {
+        js_gc_sweep_bucket(sweep_cursor++);
     }
 }
 
 void js_gc_run()
 {
+    uint64_t start = js_gc_timestamp();
+    uint32_t bucket = 0;
     #ifdef JSOS
         uint16_t* vram = (uint16_t*)0xb8000;
         uint16_t indicator = vram[79];
         vram[79] = ' ' | (5 << 12);
     #endif
+    // anything left unswept from the last cycle has to go before the mark flag flips,
+    // otherwise dead allocations would look live again:
+    js_gc_finish_sweep();
+    // the prototype lookup cache doesn't keep what it points at alive, so it's
+    // emptied before anything can be freed:
+    js_proptable_epoch++;
     current_mark_flag = !current_mark_flag;
+    marked_bytes = 0;
     js_gc_mark();
-    js_gc_sweep();
+    js_gc_clear_weak_cells();
+    // the actual sweep happens a little at a time in js_alloc:
+    sweep_cursor = 0;
+    unswept_bytes = memory_usage - marked_bytes;
+    if(marked_bytes >= critical_threshold && pressure_handler) {
+        critical_threshold = (size_t)-1;
+        pressure_handler(true);
+    }
+    collections++;
+    last_pause = js_gc_timestamp() - start;
+    total_pause += last_pause;
+    if(last_pause > max_pause) {
+        max_pause = last_pause;
+    }
+    while(bucket < JS_GC_PAUSE_BUCKETS - 1 && last_pause >= (1ull << (bucket + 16))) {
+        bucket++;
+    }
+    pause_histogram[bucket]++;
     #ifdef JSOS
         vram[79] = indicator;
     #endif
-}
\ No newline at end of file
+}
+
+static void js_gc_pin_word(intptr_t* slot)
+{
+    intptr_t p = *slot;
+    chunk_t* chunk;
+    alloc_t* alloc;
+    if(sizeof(intptr_t) == 8) {
+        p &= 0x7ffffffffffful;
+    }
+    if(p < chunks_low || p > chunks_high) {
+        return;
+    }
+    for(chunk = chunks; chunk; chunk = chunk->next) {
+        if(p >= (intptr_t)CHUNK_DATA(chunk) && p <= (intptr_t)(CHUNK_DATA(chunk) + chunk->used)) {
+            break;
+        }
+    }
+    if(chunk == NULL) {
+        return;
+    }
+    alloc = allocs_lookup((void*)p);
+    if(alloc && alloc->movable && BLOCK_HEADER(p)->owner == (void**)slot) {
+        // this is the block's own precise reference, which can be rewritten
+        BLOCK_HEADER(p)->owner_seen = true;
+        return;
+    }
+    // anything else might not be a pointer at all, so leave the whole chunk where it is:
+    chunk->pinned = true;
+}
+
+/* finds every reference into the movable space. must be run straight after a full
+   mark and sweep, so every allocation left in the table is live */
+NOINLINE static void js_gc_pin()
+{
+    jmp_buf registers;
+    intptr_t* ptrptr;
+    uint32_t i;
+    size_t offset;
+    chunk_t* chunk;
+    block_t* block;
+    alloc_t* alloc;
+    global_t* g;
+    // spill callee saved registers onto the stack so they get scanned too:
+    setjmp(registers);
+    chunks_low = 0;
+    chunks_high = 0;
+    for(chunk = chunks; chunk; chunk = chunk->next) {
+        chunk->pinned = false;
+        for(offset = 0; offset < chunk->used; offset += BLOCK_SPAN(block->size)) {
+            block = (block_t*)(CHUNK_DATA(chunk) + offset);
+            block->owner_seen = false;
+        }
+        if(chunks_low == 0 || (intptr_t)chunk < chunks_low) {
+            chunks_low = (intptr_t)chunk;
+        }
+        if((intptr_t)(CHUNK_DATA(chunk) + chunk->size) > chunks_high) {
+            chunks_high = (intptr_t)(CHUNK_DATA(chunk) + chunk->size);
+        }
+    }
+    for(ptrptr = stack_top; ptrptr >= (intptr_t*)&registers; ptrptr--) {
+        js_gc_pin_word(ptrptr);
+    }
+    for(g = globals; g; g = g->next) {
+        for(i = 0; i < g->size; i++) {
+            js_gc_pin_word((intptr_t*)&g->ptr[i]);
+        }
+    }
+    for(i = 0; i < ALLOC_MAX_BUCKETS; i++) {
+        for(alloc = allocs[i]; alloc; alloc = alloc->next) {
+            if(alloc->no_pointer) {
+                continue;
+            }
+            for(ptrptr = alloc->ptr; (intptr_t)ptrptr < (intptr_t)alloc->ptr + (intptr_t)alloc->size; ptrptr++) {
+                js_gc_pin_word(ptrptr);
+            }
+        }
+    }
+    // a live block whose owner wasn't found can't be moved either:
+    for(chunk = chunks; chunk; chunk = chunk->next) {
+        for(offset = 0; offset < chunk->used && !chunk->pinned; offset += BLOCK_SPAN(block->size)) {
+            block = (block_t*)(CHUNK_DATA(chunk) + offset);
+            if(block->owner && !block->owner_seen) {
+                chunk->pinned = true;
+            }
+        }
+        if(chunk->pinned) {
+            pinned_chunks++;
+        }
+    }
+}
+
+/* copies every live block out of a chunk. returns false if the movable space ran
+   out of memory part way through */
+static bool js_gc_evacuate_chunk(chunk_t* chunk)
+{
+    size_t offset;
+    block_t* block;
+    void* new_ptr;
+    for(offset = 0; offset < chunk->used; offset += BLOCK_SPAN(block->size)) {
+        block = (block_t*)(CHUNK_DATA(chunk) + offset);
+        if(block->owner == NULL) {
+            continue;
+        }
+        new_ptr = movable_alloc(block->size, block->owner);
+        if(new_ptr == NULL) {
+            return false;
+        }
+        memcpy(new_ptr, (char*)block + BLOCK_HEADER_SIZE, block->size);
+        allocs_move(allocs_lookup((char*)block + BLOCK_HEADER_SIZE), new_ptr);
+        *block->owner = new_ptr;
+        block->owner = NULL;
+        chunk->live -= BLOCK_SPAN(block->size);
+        bytes_evacuated += block->size;
+    }
+    return true;
+}
+
+void js_gc_compact()
+{
+    chunk_t* from;
+    chunk_t* next;
+    js_gc_run();
+    js_gc_finish_sweep();
+    pinned_chunks = 0;
+    js_gc_pin();
+    // evacuate into fresh chunks, relinking the ones that stay put as we go:
+    from = chunks;
+    chunks = NULL;
+    current_chunk = NULL;
+    for(; from; from = next) {
+        next = from->next;
+        if(from->live == 0) {
+            free(from);
+            continue;
+        }
+        if(!from->pinned && (uint64_t)from->live * 100 < (uint64_t)from->used * MOVABLE_EVACUATE_OCCUPANCY) {
+            if(js_gc_evacuate_chunk(from) && from->live == 0) {
+                free(from);
+                continue;
+            }
+        }
+        from->prev = NULL;
+        from->next = chunks;
+        if(from->next) {
+            from->next->prev = from;
+        }
+        chunks = from;
+    }
+    compactions++;
+}
+
+void js_gc_walk(void(*callback)(void*, size_t, void*), void* state)
+{
+    uint32_t i;
+    alloc_t* alloc;
+    js_gc_finish_sweep();
+    for(i = 0; i < ALLOC_MAX_BUCKETS; i++) {
+        for(alloc = allocs[i]; alloc; alloc = alloc->next) {
+            callback(alloc->ptr, alloc->size, state);
+        }
+    }
+}
+
+bool js_gc_is_allocation(void* ptr)
+{
+    return allocs_lookup(ptr) != NULL;
+}
+
+#ifdef JS_GC_DEBUG
+    #define SITE_BUCKETS 1024
+    
+    /* an open addressed table of allocation sites, keyed on file and line */
+    static uint32_t site_find(js_gc_site_t* table, char* file, int line)
+    {
+        uint32_t h = (((intptr_t)file >> 2) * 31 + line) % SITE_BUCKETS;
+        while(table[h].file && (table[h].file != file || table[h].line != line)) {
+            h = (h + 1) % SITE_BUCKETS;
+        }
+        return h;
+    }
+    
+    static js_gc_site_t* site_table_new()
+    {
+        js_gc_site_t* table = malloc(sizeof(js_gc_site_t) * SITE_BUCKETS);
+        uint32_t i, h, used = 0;
+        alloc_t* alloc;
+        if(table == NULL) {
+            return NULL;
+        }
+        memset(table, 0, sizeof(js_gc_site_t) * SITE_BUCKETS);
+        for(i = 0; i < ALLOC_MAX_BUCKETS; i++) {
+            for(alloc = allocs[i]; alloc; alloc = alloc->next) {
+                h = site_find(table, alloc->file, alloc->line);
+                if(table[h].file == NULL) {
+                    if(used == SITE_BUCKETS - 1) {
+                        // out of room, so leave the remaining sites out
+                        continue;
+                    }
+                    used++;
+                    table[h].file = alloc->file;
+                    table[h].line = alloc->line;
+                }
+                table[h].count++;
+                table[h].bytes += alloc->size;
+            }
+        }
+        return table;
+    }
+#endif
+
+size_t js_gc_allocation_sites(js_gc_site_t* sites, size_t max)
+{
+    #ifdef JS_GC_DEBUG
+        js_gc_site_t* table;
+        js_gc_site_t tmp;
+        uint32_t i;
+        size_t n = 0, j;
+        js_gc_finish_sweep();
+        table = site_table_new();
+        if(table == NULL) {
+            return 0;
+        }
+        // keep the top `max` sites by live bytes, biggest first:
+        for(i = 0; i < SITE_BUCKETS; i++) {
+            if(table[i].file == NULL) {
+                continue;
+            }
+            if(n < max) {
+                sites[n++] = table[i];
+            } else if(table[i].bytes > sites[n - 1].bytes) {
+                sites[n - 1] = table[i];
+            } else {
+                continue;
+            }
+            for(j = n - 1; j > 0 && sites[j].bytes > sites[j - 1].bytes; j--) {
+                tmp = sites[j];
+                sites[j] = sites[j - 1];
+                sites[j - 1] = tmp;
+            }
+        }
+        free(table);
+        return n;
+    #else
+        // allocation sites are only recorded in JS_GC_DEBUG builds
+        (void)sites;
+        (void)max;
+        return 0;
+    #endif
+}
+
+/* heap snapshots are a stream of unsigned LEB128 varints (written `v` below):
+
+       "JSHS" version:u8
+       type_count:v   { name_length:v name }...
+       site_count:v   { id:v file_length:v file line:v }...
+       roots:         { address:v }... 0
+       nodes:         { address:v size:v type:v site:v { edge:v }... 0 }... 0
+
+   every allocation is a node, and its edges are the words inside it that point at
+   other allocations. roots are the allocations referenced straight from the stack
+   or a registered global. a site of 0 means unknown - sites are only recorded in
+   JS_GC_DEBUG builds. retained sizes aren't in the snapshot itself, as working out
+   dominators needs far more memory than the kernel heap should spare, so they're
+   left to scripts/heap-snapshot.rb */
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BUFFER 256
+
+typedef struct {
+    js_gc_snapshot_writer_t write;
+    void* state;
+    size_t length;
+    uint8_t buff[SNAPSHOT_BUFFER];
+} snapshot_t;
+
+static void snapshot_flush(snapshot_t* snap)
+{
+    if(snap->length) {
+        snap->write(snap->buff, snap->length, snap->state);
+        snap->length = 0;
+    }
+}
+
+static void snapshot_byte(snapshot_t* snap, uint8_t byte)
+{
+    if(snap->length == SNAPSHOT_BUFFER) {
+        snapshot_flush(snap);
+    }
+    snap->buff[snap->length++] = byte;
+}
+
+static void snapshot_varint(snapshot_t* snap, uintptr_t value)
+{
+    while(value >= 0x80) {
+        snapshot_byte(snap, (value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    snapshot_byte(snap, value);
+}
+
+static void snapshot_string(snapshot_t* snap, char* str)
+{
+    size_t len = strlen(str), i;
+    snapshot_varint(snap, len);
+    for(i = 0; i < len; i++) {
+        snapshot_byte(snap, str[i]);
+    }
+}
+
+static alloc_t* snapshot_lookup(intptr_t p)
+{
+    if(sizeof(intptr_t) == 8) {
+        p &= 0x7ffffffffffful;
+    }
+    return allocs_lookup((void*)p);
+}
+
+NOINLINE static void snapshot_roots(snapshot_t* snap)
+{
+    jmp_buf registers;
+    intptr_t* ptrptr;
+    alloc_t* alloc;
+    global_t* g;
+    uint32_t i;
+    // spill callee saved registers onto the stack so they get scanned too:
+    setjmp(registers);
+    for(ptrptr = stack_top; ptrptr >= (intptr_t*)&registers; ptrptr--) {
+        if((alloc = snapshot_lookup(*ptrptr))) {
+            snapshot_varint(snap, (uintptr_t)alloc->ptr);
+        }
+    }
+    for(g = globals; g; g = g->next) {
+        for(i = 0; i < g->size; i++) {
+            if((alloc = snapshot_lookup((intptr_t)g->ptr[i]))) {
+                snapshot_varint(snap, (uintptr_t)alloc->ptr);
+            }
+        }
+    }
+    snapshot_varint(snap, 0);
+}
+
+void js_gc_snapshot(js_gc_classifier_t classify, char** type_names, uint32_t type_count, js_gc_snapshot_writer_t write, void* state)
+{
+    snapshot_t snap;
+    intptr_t* ptrptr;
+    alloc_t* alloc;
+    alloc_t* edge;
+    uint32_t i;
+    #ifdef JS_GC_DEBUG
+        js_gc_site_t* sites;
+        uint32_t site_count = 0;
+    #endif
+    snap.write = write;
+    snap.state = state;
+    snap.length = 0;
+    // only live allocations should be left in the table:
+    js_gc_run();
+    js_gc_finish_sweep();
+    
+    snapshot_byte(&snap, 'J');
+    snapshot_byte(&snap, 'S');
+    snapshot_byte(&snap, 'H');
+    snapshot_byte(&snap, 'S');
+    snapshot_byte(&snap, SNAPSHOT_VERSION);
+    snapshot_varint(&snap, type_count);
+    for(i = 0; i < type_count; i++) {
+        snapshot_string(&snap, type_names[i]);
+    }
+    #ifdef JS_GC_DEBUG
+        sites = site_table_new();
+        for(i = 0; sites && i < SITE_BUCKETS; i++) {
+            site_count += sites[i].file != NULL;
+        }
+        snapshot_varint(&snap, site_count);
+        for(i = 0; sites && i < SITE_BUCKETS; i++) {
+            if(sites[i].file) {
+                snapshot_varint(&snap, i + 1);
+                snapshot_string(&snap, sites[i].file);
+                snapshot_varint(&snap, sites[i].line);
+            }
+        }
+    #else
+        snapshot_varint(&snap, 0);
+    #endif
+    
+    snapshot_roots(&snap);
+    
+    for(i = 0; i < ALLOC_MAX_BUCKETS; i++) {
+        for(alloc = allocs[i]; alloc; alloc = alloc->next) {
+            snapshot_varint(&snap, (uintptr_t)alloc->ptr);
+            snapshot_varint(&snap, alloc->size);
+            snapshot_varint(&snap, classify ? classify(alloc->ptr, alloc->size) : 0);
+            #ifdef JS_GC_DEBUG
+                if(sites) {
+                    uint32_t h = site_find(sites, alloc->file, alloc->line);
+                    snapshot_varint(&snap, sites[h].file ? h + 1 : 0);
+                } else {
+                    snapshot_varint(&snap, 0);
+                }
+            #else
+                snapshot_varint(&snap, 0);
+            #endif
+            if(!alloc->no_pointer) {
+                for(ptrptr = alloc->ptr; (intptr_t)ptrptr < (intptr_t)alloc->ptr + (intptr_t)alloc->size; ptrptr++) {
+                    if((edge = snapshot_lookup(*ptrptr))) {
+                        snapshot_varint(&snap, (uintptr_t)edge->ptr);
+                    }
+                }
+            }
+            snapshot_varint(&snap, 0);
+        }
+    }
+    snapshot_varint(&snap, 0);
+    snapshot_flush(&snap);
+    #ifdef JS_GC_DEBUG
+        free(sites);
+    #endif
+}
@@ -0,0 +1,75 @@
+#include <string.h>
+#include "hashindex.h"
+#include "gc.h"
+
+js_hashindex_slot_t* js_hashindex_new(uint32_t size)
+{
+    js_hashindex_slot_t* index = js_alloc_no_pointer(sizeof(js_hashindex_slot_t) * size);
+    memset(index, 0xff, sizeof(js_hashindex_slot_t) * size);
+    return index;
+}
+
+void js_hashindex_clear(js_hashindex_slot_t* index, uint32_t mask)
+{
+    memset(index, 0xff, sizeof(js_hashindex_slot_t) * (mask + 1));
+}
+
+/* how far a slot's entry is from where its hash would ideally put it */
+static uint32_t probe_distance(js_hashindex_slot_t* index, uint32_t mask, uint32_t slot)
+{
+    return (slot - (index[slot].hash & mask)) & mask;
+}
+
+void js_hashindex_insert(js_hashindex_slot_t* index, uint32_t mask, uint32_t hash, uint32_t entry)
+{
+    uint32_t slot = hash & mask;
+    uint32_t dist = 0, existing;
+    js_hashindex_slot_t carry = { hash, entry }, tmp;
+    while(index[slot].entry != JS_HASHINDEX_EMPTY) {
+        // robin hood: whoever is further from home gets the slot
+        existing = probe_distance(index, mask, slot);
+        if(existing < dist) {
+            tmp = index[slot];
+            index[slot] = carry;
+            carry = tmp;
+            dist = existing;
+        }
+        slot = (slot + 1) & mask;
+        dist++;
+    }
+    index[slot] = carry;
+}
+
+uint32_t js_hashindex_find(js_hashindex_slot_t* index, uint32_t mask, uint32_t hash, js_hashindex_match_t match, void* table, void* key)
+{
+    uint32_t slot, dist = 0;
+    js_hashindex_slot_t* s;
+    if(index == NULL) {
+        return JS_HASHINDEX_EMPTY;
+    }
+    slot = hash & mask;
+    while(true) {
+        s = &index[slot];
+        // an entry closer to home than we are means ours would have displaced it, so isn't here:
+        if(s->entry == JS_HASHINDEX_EMPTY || probe_distance(index, mask, slot) < dist) {
+            return JS_HASHINDEX_EMPTY;
+        }
+        if(s->hash == hash && match(table, s->entry, key)) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+        dist++;
+    }
+}
+
+void js_hashindex_remove(js_hashindex_slot_t* index, uint32_t mask, uint32_t slot)
+{
+    uint32_t next = (slot + 1) & mask;
+    // shift the following run back a slot rather than leaving a tombstone:
+    while(index[next].entry != JS_HASHINDEX_EMPTY && probe_distance(index, mask, next) > 0) {
+        index[slot] = index[next];
+        slot = next;
+        next = (next + 1) & mask;
+    }
+    index[slot].entry = JS_HASHINDEX_EMPTY;
+}
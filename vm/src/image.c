@@ -2,6 +2,7 @@
 #include <string.h>
 #include "image.h"
 #include "gc.h"
+#include "lib.h"
 
 /* this function is insecure. todo: sprinkle some more bounds checks through */
 
@@ -32,6 +33,16 @@ js_image_t* js_image_parse(char* buff, uint32_t buff_size)
         CHECK_AHEAD(4);
         image->sections[i].var_count = *(uint32_t*)buff;
         buff += 4;
+        CHECK_AHEAD(4);
+        image->sections[i].local_count = *(uint32_t*)buff;
+        buff += 4;
+        CHECK_AHEAD(4);
+        image->sections[i].exception_range_count = *(uint32_t*)buff;
+        buff += 4;
+        CHECK_AHEAD(sizeof(js_exception_range_t) * image->sections[i].exception_range_count);
+        image->sections[i].exception_ranges = js_alloc_no_pointer(sizeof(js_exception_range_t) * image->sections[i].exception_range_count);
+        memcpy(image->sections[i].exception_ranges, buff, sizeof(js_exception_range_t) * image->sections[i].exception_range_count);
+        buff += sizeof(js_exception_range_t) * image->sections[i].exception_range_count;
         CHECK_AHEAD(sz);
         image->sections[i].instructions = js_alloc_no_pointer(sz);
         memcpy(image->sections[i].instructions, buff, sz);
@@ -51,6 +62,9 @@ js_image_t* js_image_parse(char* buff, uint32_t buff_size)
         CHECK_AHEAD(sz + 1);
         memcpy(image->strings[i]->buff, buff, sz + 1);
         buff += sz + 1;
+        // strings pushed from the image are copies of these, so working out their
+        // numbers here saves doing it every time they're compared with a number:
+        js_number_parse(image->strings[i]);
     }
     return image;
 }
\ No newline at end of file
@@ -19,4 +19,6 @@ void js_lib_initialize(js_vm_t* vm)
     js_lib_number_initialize(vm);
     js_lib_string_initialize(vm);
     js_lib_math_initialize(vm);
+    js_lib_weakref_initialize(vm);
+    js_lib_map_initialize(vm);
 }
\ No newline at end of file
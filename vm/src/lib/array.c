@@ -4,16 +4,27 @@
 #include "lib.h"
 #include "gc.h"
 #include "object.h"
+#include "elements.h"
 #include "exception.h"
 
+/* arrays keep their items in a vector until less than a quarter of it would be in
+   use, then switch to a sparse elements store (dictionary mode). they switch back
+   once they're half full again */
+
 typedef struct {
     js_value_t base;
     uint32_t length;
     uint32_t items_length;
     uint32_t capacity;
-    VAL* items;
+    uint32_t count;         // items that aren't holes
+    VAL* items;             // holes are JS_VALUE_HOLE
+    js_elements_t* sparse;  // non-NULL in dictionary mode, when items isn't used
+    bool shared;            // items has been lent out as a call's argv, so copy it before writing
 } js_array_t;
 
+/* arrays shorter than this stay dense however empty they are */
+#define ARRAY_DENSE_MIN 64
+
 static bool statically_initialized;
 static js_object_internal_methods_t array_vtable;
 
@@ -32,12 +43,15 @@ VAL js_make_array(struct js_vm* vm, uint32_t count, VAL* items)
     ary->base.object.vtable = &array_vtable;
     ary->base.object.prototype = vm->lib.Array_prototype;
     ary->base.object.class = vm->lib.Array;
-    ary->base.object.properties = js_st_table_new();
+    ary->base.object.properties = js_proptable_new();
     ary->length = count;
     ary->items_length = count;
+    ary->count = count;
     ary->capacity = count < 4 ? 4 : count;
     ary->items = js_alloc(sizeof(VAL) * ary->capacity);
-    memcpy(ary->items, items, sizeof(VAL) * ary->capacity);
+    if(count) {
+        memcpy(ary->items, items, sizeof(VAL) * count);
+    }
     
     VAL obj = js_value_make_pointer((js_value_t*)ary);
     
@@ -47,41 +61,89 @@ VAL js_make_array(struct js_vm* vm, uint32_t count, VAL* items)
     return obj;
 }
 
-VAL* js_array_items(VAL array, uint32_t* count)
+static bool array_lookup(js_array_t* ary, uint32_t index, VAL* value)
 {
-    if(js_value_get_type(array) != JS_T_ARRAY) {
-        js_panic("non array passed to js_array_items");
+    if(ary->sparse) {
+        return js_elements_get(ary->sparse, index, value);
     }
-    js_array_t* ary = (js_array_t*)js_value_get_pointer(array);
-    VAL* out = js_alloc(sizeof(VAL) * ary->length);
-    memcpy(out, ary->items, sizeof(VAL) * ary->items_length);
+    if(index < ary->items_length && ary->items[index].i != JS_VALUE_HOLE) {
+        *value = ary->items[index];
+        return true;
+    }
+    return false;
+}
+
+/* holes read as undefined */
+static VAL array_item(js_array_t* ary, uint32_t index)
+{
+    VAL value;
+    if(array_lookup(ary, index, &value)) {
+        return value;
+    }
+    return js_value_undefined();
+}
+
+/* the indices of every item that isn't a hole, in order */
+static uint32_t* array_indices(js_array_t* ary, uint32_t* count)
+{
+    uint32_t* indices;
     uint32_t i;
-    for(i = ary->items_length; i < ary->length; i++) {
-        out[i] = js_value_undefined();
+    if(ary->sparse) {
+        return js_elements_indices(ary->sparse, count);
     }
-    *count = ary->length;
-    return out;
+    indices = js_alloc_no_pointer(sizeof(uint32_t) * (ary->count ? ary->count : 1));
+    *count = 0;
+    for(i = 0; i < ary->items_length; i++) {
+        if(ary->items[i].i != JS_VALUE_HOLE) {
+            indices[(*count)++] = i;
+        }
+    }
+    return indices;
 }
 
-uint32_t js_array_length(VAL array)
+/* called before items is written in place, so arguments lent out by
+   js_array_borrow_items keep the values they were called with */
+static void own_items(js_array_t* ary)
 {
-    if(js_value_get_type(array) != JS_T_ARRAY) {
-        js_panic("non array passed to js_array_length");
+    if(ary->shared) {
+        VAL* items = js_alloc(sizeof(VAL) * ary->capacity);
+        memcpy(items, ary->items, sizeof(VAL) * ary->items_length);
+        ary->items = items;
+        ary->shared = false;
     }
-    js_array_t* ary = (js_array_t*)js_value_get_pointer(array);
-    return ary->length;
 }
 
-VAL js_array_get(VAL array, uint32_t idx)
+static void make_sparse(js_array_t* ary)
 {
-    if(js_value_get_type(array) != JS_T_ARRAY) {
-        js_panic("non array passed to js_array_get");
+    uint32_t i;
+    ary->sparse = js_elements_new();
+    for(i = 0; i < ary->items_length; i++) {
+        if(ary->items[i].i != JS_VALUE_HOLE) {
+            js_elements_put(ary->sparse, i, ary->items[i]);
+        }
     }
-    js_array_t* ary = (js_array_t*)js_value_get_pointer(array);
-    if(idx < ary->items_length) {
-        return ary->items[idx];
+    ary->items = NULL;
+    ary->items_length = 0;
+    ary->capacity = 0;
+    ary->count = 0;
+    ary->shared = false;
+}
+
+static void make_dense(js_array_t* ary)
+{
+    uint32_t count, i;
+    uint32_t* indices = js_elements_indices(ary->sparse, &count);
+    ary->items_length = count ? indices[count - 1] + 1 : 0;
+    ary->capacity = ary->items_length < 4 ? 4 : ary->items_length;
+    ary->items = js_alloc(sizeof(VAL) * ary->capacity);
+    for(i = 0; i < ary->items_length; i++) {
+        ary->items[i].i = JS_VALUE_HOLE;
     }
-    return js_value_undefined();
+    for(i = 0; i < count; i++) {
+        js_elements_get(ary->sparse, indices[i], &ary->items[indices[i]]);
+    }
+    ary->count = count;
+    ary->sparse = NULL;
 }
 
 static void array_put(js_array_t* ary, uint32_t index, VAL val)
@@ -89,6 +151,20 @@ static void array_put(js_array_t* ary, uint32_t index, VAL val)
     if(index >= ary->length) {
         ary->length = index + 1;
     }
+    if(ary->sparse) {
+        js_elements_put(ary->sparse, index, val);
+        if(ary->sparse->count * 2 >= ary->length) {
+            make_dense(ary);
+        }
+        return;
+    }
+    if(index >= ary->items_length && index >= ARRAY_DENSE_MIN && (ary->count + 1) * 4 < index + 1) {
+        // a vector would be mostly holes:
+        make_sparse(ary);
+        js_elements_put(ary->sparse, index, val);
+        return;
+    }
+    own_items(ary);
     if(index >= ary->capacity) {
         while(index >= ary->capacity) {
             ary->capacity *= 2;
@@ -96,36 +172,100 @@ static void array_put(js_array_t* ary, uint32_t index, VAL val)
         ary->items = js_realloc(ary->items, sizeof(VAL) * ary->capacity);
     }
     while(index >= ary->items_length) {
-        ary->items[ary->items_length++] = js_value_undefined();
+        ary->items[ary->items_length++].i = JS_VALUE_HOLE;
+    }
+    if(ary->items[index].i == JS_VALUE_HOLE) {
+        ary->count++;
     }
     ary->items[index] = val;
 }
 
-static bool is_string_integer(js_string_t* str)
+static void array_delete(js_array_t* ary, uint32_t index)
+{
+    if(ary->sparse) {
+        js_elements_delete(ary->sparse, index);
+        return;
+    }
+    if(index >= ary->items_length || ary->items[index].i == JS_VALUE_HOLE) {
+        return;
+    }
+    own_items(ary);
+    ary->items[index].i = JS_VALUE_HOLE;
+    ary->count--;
+    while(ary->items_length > 0 && ary->items[ary->items_length - 1].i == JS_VALUE_HOLE) {
+        ary->items_length--;
+    }
+    if(ary->items_length >= ARRAY_DENSE_MIN && ary->count * 4 < ary->items_length) {
+        make_sparse(ary);
+    }
+}
+
+VAL* js_array_items(VAL array, uint32_t* count)
 {
+    if(js_value_get_type(array) != JS_T_ARRAY) {
+        js_panic("non array passed to js_array_items");
+    }
+    js_array_t* ary = (js_array_t*)js_value_get_pointer(array);
+    VAL* out = js_alloc(sizeof(VAL) * ary->length);
     uint32_t i;
-    for(i = 0; i < str->length; i++) {
-        if(str->buff[i] < '0' || str->buff[i] > '9') {
-            // not an integer
-            return false;
-        }
+    for(i = 0; i < ary->length; i++) {
+        out[i] = array_item(ary, i);
     }
-    return true;
+    *count = ary->length;
+    return out;
+}
+
+VAL* js_array_borrow_items(VAL array, uint32_t* count)
+{
+    if(js_value_get_type(array) != JS_T_ARRAY) {
+        js_panic("non array passed to js_array_borrow_items");
+    }
+    js_array_t* ary = (js_array_t*)js_value_get_pointer(array);
+    if(ary->sparse || ary->count != ary->length) {
+        // holes have to read as undefined:
+        return js_array_items(array, count);
+    }
+    ary->shared = true;
+    *count = ary->length;
+    return ary->items;
+}
+
+uint32_t js_array_length(VAL array)
+{
+    if(js_value_get_type(array) != JS_T_ARRAY) {
+        js_panic("non array passed to js_array_length");
+    }
+    js_array_t* ary = (js_array_t*)js_value_get_pointer(array);
+    return ary->length;
+}
+
+VAL js_array_get(VAL array, uint32_t idx)
+{
+    if(js_value_get_type(array) != JS_T_ARRAY) {
+        js_panic("non array passed to js_array_get");
+    }
+    return array_item((js_array_t*)js_value_get_pointer(array), idx);
+}
+
+static VAL array_vtable_get_index(js_value_t* obj, uint32_t index)
+{
+    VAL value;
+    if(array_lookup((js_array_t*)obj, index, &value)) {
+        return value;
+    }
+    return js_object_base_vtable()->get_index(obj, index);
+}
+
+static void array_vtable_put_index(js_value_t* obj, uint32_t index, VAL val)
+{
+    array_put((js_array_t*)obj, index, val);
 }
 
 static VAL array_vtable_get(js_value_t* obj, js_string_t* prop)
 {
     uint32_t index;
-    js_array_t* ary = (js_array_t*)obj;
-    if(is_string_integer(prop)) {
-        index = atoi(prop->buff);
-        if(index < ary->items_length) {
-            return ary->items[index];
-        }
-        if(index >= ary->items_length && index < ary->length) {
-            // sparse array
-            return js_value_undefined();
-        }
+    if(js_string_to_index(prop, &index)) {
+        return array_vtable_get_index(obj, index);
     }
     return js_object_base_vtable()->get(obj, prop);
 }
@@ -133,10 +273,8 @@ static VAL array_vtable_get(js_value_t* obj, js_string_t* prop)
 static void array_vtable_put(js_value_t* obj, js_string_t* prop, VAL val)
 {
     uint32_t index;
-    js_array_t* ary = (js_array_t*)obj;
-    if(is_string_integer(prop)) {
-        index = atoi(prop->buff);
-        array_put(ary, index, val);
+    if(js_string_to_index(prop, &index)) {
+        array_put((js_array_t*)obj, index, val);
     } else {
         js_object_base_vtable()->put(obj, prop, val);
     }
@@ -145,10 +283,9 @@ static void array_vtable_put(js_value_t* obj, js_string_t* prop, VAL val)
 static bool array_vtable_has_property(js_value_t* obj, js_string_t* prop)
 {
     uint32_t index;
-    js_array_t* ary = (js_array_t*)obj;
-    if(is_string_integer(prop)) {
-        index = atoi(prop->buff);
-        return index < ary->items_length;
+    VAL value;
+    if(js_string_to_index(prop, &index)) {
+        return array_lookup((js_array_t*)obj, index, &value);
     }
     return js_object_base_vtable()->has_property(obj, prop);
 }
@@ -156,12 +293,8 @@ static bool array_vtable_has_property(js_value_t* obj, js_string_t* prop)
 static bool array_vtable_delete(js_value_t* obj, js_string_t* prop)
 {
     uint32_t index;
-    js_array_t* ary = (js_array_t*)obj;
-    if(is_string_integer(prop)) {
-        index = atoi(prop->buff);
-        if(index < ary->items_length) {
-            ary->items[index] = js_value_undefined();
-        }
+    if(js_string_to_index(prop, &index)) {
+        array_delete((js_array_t*)obj, index);
         return true;
     }
     return js_object_base_vtable()->delete(obj, prop);
@@ -169,15 +302,45 @@ static bool array_vtable_delete(js_value_t* obj, js_string_t* prop)
 
 static js_string_t** array_vtable_keys(js_value_t* obj, uint32_t* out_count)
 {
-    uint32_t count, i;
+    uint32_t count, index_count, i;
+    uint32_t* indices = array_indices((js_array_t*)obj, &index_count);
+    js_string_t** named = js_object_base_vtable()->keys(obj, &count);
+    // indices come before named properties:
+    js_string_t** keys = js_alloc(sizeof(*keys) * (index_count + count));
+    for(i = 0; i < index_count; i++) {
+        keys[i] = js_string_from_index(indices[i]);
+    }
+    memcpy(keys + index_count, named, sizeof(*keys) * count);
+    *out_count = index_count + count;
+    return keys;
+}
+
+static bool array_vtable_next_index(js_value_t* obj, uint32_t* index, js_index_cursor_t* cursor)
+{
     js_array_t* ary = (js_array_t*)obj;
-    js_string_t** keys = js_object_base_vtable()->keys(obj, &count);
-    keys = js_realloc(keys, sizeof(*keys) * (count + ary->items_length));
-    for(i = 0; i < ary->items_length; i++) {
-        keys[count + i] = js_string_format("%d", i);
+    uint32_t i;
+    VAL value;
+    if(cursor->indices == NULL && !ary->sparse) {
+        for(i = *index; i < ary->items_length; i++) {
+            if(ary->items[i].i != JS_VALUE_HOLE) {
+                *index = i;
+                return true;
+            }
+        }
+        return false;
     }
-    *out_count = count + ary->items_length;
-    return keys;
+    if(cursor->indices == NULL) {
+        // dictionary mode has no order to walk in, so go through a snapshot of the indices instead:
+        cursor->indices = array_indices(ary, &cursor->count);
+    }
+    while(cursor->position < cursor->count) {
+        i = cursor->indices[cursor->position++];
+        if(i >= *index && array_lookup(ary, i, &value)) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
 }
 
 char* utoa(unsigned int value, char* buff, int base)
@@ -226,11 +389,10 @@ static js_array_t* as_array(js_vm_t* vm, VAL val)
 static VAL Array_call(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     js_array_t* ary;
-    uint32_t ary_length;
     if(argc == 1) {
-        ary_length = js_to_uint32(argv[0]);
-        ary = (js_array_t*)js_value_get_pointer(js_make_array(vm, ary_length, NULL));
-        ary->length = ary_length;
+        // all holes, which don't take up any room
+        ary = (js_array_t*)js_value_get_pointer(js_make_array(vm, 0, NULL));
+        ary->length = js_to_uint32(argv[0]);
         return js_value_make_pointer((js_value_t*)ary);
     } else {
         return js_make_array(vm, argc, argv);
@@ -262,23 +424,25 @@ static VAL Array_prototype_slice(js_vm_t* vm, void* state, VAL this, uint32_t ar
     js_array_t* new_ary = (js_array_t*)js_value_get_pointer(js_make_array(vm, 0, NULL));
     uint32_t begin = js_to_uint32(argv[0]);
     uint32_t end = ary->length;
+    uint32_t i, count;
+    uint32_t* indices;
     if(argc >= 2) {
         end = js_to_uint32(argv[1]);
         if(end > ary->length) {
             end = ary->length;
         }
     }
-    if(ary->items_length >= begin) {
-        new_ary->items_length = (end < ary->items_length ? end : ary->items_length) - begin;
-        new_ary->capacity = new_ary->items_length;
-        new_ary->items = js_alloc(sizeof(VAL) * new_ary->items_length);
-        new_ary->length = end - begin;
-        memcpy(new_ary->items, ary->items + begin, sizeof(VAL) * new_ary->items_length);
-    } else if(end > begin) {
-        new_ary->length = ary->length - begin;
-    } else {
-        new_ary->length = 0;
+    if(end <= begin) {
+        return js_value_make_pointer((js_value_t*)new_ary);
     }
+    // only visit the items that are actually there, so slicing a sparse array stays cheap:
+    indices = array_indices(ary, &count);
+    for(i = 0; i < count; i++) {
+        if(indices[i] >= begin && indices[i] < end) {
+            array_put(new_ary, indices[i] - begin, array_item(ary, indices[i]));
+        }
+    }
+    new_ary->length = end - begin;
     return js_value_make_pointer((js_value_t*)new_ary);
 }
 
@@ -293,8 +457,11 @@ static VAL Array_prototype_splice(js_vm_t* vm, void* state, VAL this, uint32_t a
     }
     
     uint32_t begin = js_to_uint32(argv[0]);
+    if(begin > ary->length) {
+        begin = ary->length;
+    }
     uint32_t remove_length = argc > 1 ? js_to_uint32(argv[1]) : ary->length - begin;
-    if(remove_length + begin > ary->length) {
+    if(remove_length > ary->length - begin) {
         remove_length = ary->length - begin;
     }
     uint32_t replace_length = argc > 2 ? argc - 2 : 0;
@@ -306,37 +473,27 @@ static VAL Array_prototype_splice(js_vm_t* vm, void* state, VAL this, uint32_t a
     uint32_t i;
     VAL* old_items = js_alloc(sizeof(VAL) * (remove_length > 4 ? remove_length : 4));
     for(i = 0; i < remove_length; i++) {
-        uint32_t ary_i = begin + i;
-        if(ary_i > ary->items_length) {
-            old_items[i] = js_value_undefined();
-        } else {
-            old_items[i] = ary->items[ary_i];
-        }
+        old_items[i] = array_item(ary, begin + i);
     }
     
     VAL* new_items = js_alloc(sizeof(VAL) * (new_length > 4 ? new_length : 4));
     uint32_t new_index = 0;
     for(i = 0; i < begin; i++) {
-        if(i > ary->items_length) {
-            new_items[new_index++] = js_value_undefined();
-        } else {
-            new_items[new_index++] = ary->items[i];
-        }
+        new_items[new_index++] = array_item(ary, i);
     }
     for(i = 0; i < replace_length; i++) {
         new_items[new_index++] = argv[2 + i];
     }
-    for(i = trailer_begin; i < ary->items_length; i++) {
-        if(i > ary->items_length) {
-            new_items[new_index++] = js_value_undefined();
-        } else {
-            new_items[new_index++] = ary->items[i];
-        }
+    for(i = trailer_begin; i < ary->length; i++) {
+        new_items[new_index++] = array_item(ary, i);
     }
     ary->items_length = new_length;
     ary->length = new_length;
+    ary->count = new_length;
     ary->capacity = new_length > 4 ? new_length : 4;
     ary->items = new_items;
+    ary->sparse = NULL;
+    ary->shared = false;
     
     return js_make_array(vm, remove_length, old_items);
 }
@@ -348,11 +505,11 @@ static VAL Array_prototype_join(js_vm_t* vm, void* state, VAL this, uint32_t arg
         return js_value_make_cstring("");
     }
     js_string_t* joiner = argc > 0 ? js_to_js_string_t(argv[0]) : js_cstring(",");
-    js_string_t* str = js_to_js_string_t(ary->items_length > 0 ? ary->items[0] : js_value_undefined());
+    js_string_t* str = js_to_js_string_t(array_item(ary, 0));
     uint32_t i;
     for(i = 1; i < ary->length; i++) {
         str = js_string_concat(str, joiner);
-        str = js_string_concat(str, js_to_js_string_t(ary->items_length > i ? ary->items[i] : js_value_undefined()));
+        str = js_string_concat(str, js_to_js_string_t(array_item(ary, i)));
     }
     return js_value_wrap_string(str);
 }
@@ -371,11 +528,7 @@ static VAL Array_prototype_concat(js_vm_t* vm, void* state, VAL this, uint32_t a
     }
     VAL* vec = js_alloc(sizeof(VAL) * total_len);
     for(i = 0; i < ary->length; i++) {
-        if(i < ary->items_length) {
-            vec[i] = ary->items[i];
-        } else {
-            vec[i] = js_value_undefined();
-        }
+        vec[i] = array_item(ary, i);
     }
     uint32_t j;
     for(j = 0; j < argc; j++) {
@@ -383,11 +536,7 @@ static VAL Array_prototype_concat(js_vm_t* vm, void* state, VAL this, uint32_t a
             js_array_t* argary = (js_array_t*)js_value_get_pointer(argv[j]);
             uint32_t k;
             for(k = 0; k < argary->length; k++) {
-                if(k < argary->items_length) {
-                    vec[i++] = argary->items[k];
-                } else {
-                    vec[i++] = js_value_undefined();
-                }
+                vec[i++] = array_item(argary, k);
             }
         } else {
             vec[i++] = argv[j];
@@ -399,23 +548,26 @@ static VAL Array_prototype_concat(js_vm_t* vm, void* state, VAL this, uint32_t a
 static VAL Array_prototype_reduce(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     js_array_t* ary = as_array(vm, this);
-    uint32_t i = 0;
+    uint32_t i = 0, count;
+    uint32_t* indices;
     VAL callback = argc ? argv[0] : js_value_undefined();
     if(js_value_get_type(callback) != JS_T_FUNCTION) {
         js_throw_error(vm->lib.TypeError, "First argument to Array.prototype.reduce must be a function");
     }
-    if(ary->items_length == 0 && argc < 2) {
+    // holes are skipped:
+    indices = array_indices(ary, &count);
+    if(count == 0 && argc < 2) {
         js_throw_error(vm->lib.TypeError, "Reduce of empty array with no initial value");
     }
     VAL acc;
     if(argc > 1) {
         acc = argv[1];
     } else {
-        acc = ary->items[0];
+        acc = array_item(ary, indices[0]);
         i++;
     }
-    for(; i < ary->items_length; i++) {
-        VAL args[] = { acc, ary->items[i], js_value_make_double(i), js_value_make_pointer((js_value_t*)ary) };
+    for(; i < count; i++) {
+        VAL args[] = { acc, array_item(ary, indices[i]), js_value_make_double(indices[i]), js_value_make_pointer((js_value_t*)ary) };
         acc = js_call(callback, js_value_null(), 4, args);
     }
     return acc;
@@ -424,23 +576,25 @@ static VAL Array_prototype_reduce(js_vm_t* vm, void* state, VAL this, uint32_t a
 static VAL Array_prototype_reduceRight(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     js_array_t* ary = as_array(vm, this);
-    uint32_t i = 0;
+    uint32_t i = 0, count;
+    uint32_t* indices;
     VAL callback = argc ? argv[0] : js_value_undefined();
     if(js_value_get_type(callback) != JS_T_FUNCTION) {
         js_throw_error(vm->lib.TypeError, "First argument to Array.prototype.reduce must be a function");
     }
-    if(ary->items_length == 0 && argc < 2) {
+    indices = array_indices(ary, &count);
+    if(count == 0 && argc < 2) {
         js_throw_error(vm->lib.TypeError, "Reduce of empty array with no initial value");
     }
     VAL acc;
     if(argc > 1) {
         acc = argv[1];
     } else {
-        acc = ary->items[ary->items_length - 1];
+        acc = array_item(ary, indices[count - 1]);
         i++;
     }
-    for(; i < ary->items_length; i++) {
-        VAL args[] = { acc, ary->items[ary->items_length - i - 1], js_value_make_double(ary->items_length - i - 1), js_value_make_pointer((js_value_t*)ary) };
+    for(; i < count; i++) {
+        VAL args[] = { acc, array_item(ary, indices[count - i - 1]), js_value_make_double(indices[count - i - 1]), js_value_make_pointer((js_value_t*)ary) };
         acc = js_call(callback, js_value_null(), 4, args);
     }
     return acc;
@@ -456,6 +610,9 @@ void js_lib_array_initialize(js_vm_t* vm)
         array_vtable.has_property = array_vtable_has_property;
         array_vtable.delete = array_vtable_delete;
         array_vtable.keys = array_vtable_keys;
+        array_vtable.get_index = array_vtable_get_index;
+        array_vtable.put_index = array_vtable_put_index;
+        array_vtable.next_index = array_vtable_next_index;
     }
     
     vm->lib.Array = js_value_make_native_function(vm, NULL, js_cstring("Array"), Array_call, Array_call);
@@ -38,7 +38,7 @@ VAL js_make_boolean_object(js_vm_t* vm, bool boolean)
     obj->base.object.vtable = js_object_base_vtable();
     obj->base.object.prototype = vm->lib.Boolean_prototype;
     obj->base.object.class = vm->lib.Boolean;
-    obj->base.object.properties = js_st_table_new();
+    obj->base.object.properties = js_proptable_new();
     obj->boolean = boolean;
     return js_value_make_pointer((js_value_t*)obj);
 }
@@ -47,7 +47,11 @@ static VAL Error_prototype_stack(js_vm_t* vm, void* state, VAL this, uint32_t ar
         // wtf?
         js_throw_error(vm->lib.TypeError, "can't access Error.prototype.stack on non object");
     }
-    return js_value_wrap_string(js_value_get_pointer(this)->object.stack_trace);
+    if(!js_value_get_pointer(this)->object.stack_trace) {
+        // not thrown yet:
+        return js_value_undefined();
+    }
+    return js_value_wrap_string(js_stack_trace_string(js_value_get_pointer(this)->object.stack_trace));
 }
 
 VAL js_make_error(VAL class, js_string_t* message)
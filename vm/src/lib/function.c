@@ -29,12 +29,8 @@ static VAL Function_prototype_call(js_vm_t* vm, void* state, VAL this, uint32_t
     if(argc == 0) {
         return js_call(this, vm->global_scope->global_object, 0, NULL);
     } else {
-        VAL* new_args = NULL;
-        if(argc >= 2) {
-            new_args = js_alloc(sizeof(VAL) * (argc - 1));
-            memcpy(new_args, argv + 1, sizeof(VAL) * (argc - 1));
-        }
-        return js_call(this, argv[0], argc - 1, new_args);
+        // callees only ever read argv, so the rest of ours can be passed straight on:
+        return js_call(this, argv[0], argc - 1, argv + 1);
     }
 }
 
@@ -52,7 +48,7 @@ static VAL Function_prototype_apply(js_vm_t* vm, void* state, VAL this, uint32_t
             js_throw_error(vm->lib.TypeError, "expected array as second parameter to Function.prototype.apply");
         }
         uint32_t new_argc;
-        VAL* new_args = js_array_items(argv[1], &new_argc);
+        VAL* new_args = js_array_borrow_items(argv[1], &new_argc);
         return js_call(this, argv[0], new_argc, new_args);
     }
 }
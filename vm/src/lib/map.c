@@ -0,0 +1,283 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "lib.h"
+#include "object.h"
+#include "valtable.h"
+#include "gc.h"
+#include "exception.h"
+
+/* Map and Set are the same object underneath - a set just maps each value to itself */
+
+typedef struct {
+    js_value_t base;
+    js_valtable_t* table;
+} js_map_t;
+
+static js_map_t* get_map(js_vm_t* vm, VAL this, VAL class, char* name, char* method)
+{
+    if(!js_value_is_object(this) || js_value_get_pointer(js_value_get_pointer(this)->object.class) != js_value_get_pointer(class)) {
+        js_throw_error(vm->lib.TypeError, "%s.prototype.%s() is not generic", name, method);
+    }
+    return (js_map_t*)js_value_get_pointer(this);
+}
+
+static VAL make_map(js_vm_t* vm, VAL prototype, VAL class)
+{
+    js_map_t* map = js_alloc(sizeof(js_map_t));
+    map->base.type = JS_T_OBJECT;
+    map->base.object.vtable = js_object_base_vtable();
+    map->base.object.prototype = prototype;
+    map->base.object.class = class;
+    map->base.object.properties = js_proptable_new();
+    map->table = js_valtable_new();
+    return js_value_make_pointer((js_value_t*)map);
+}
+
+typedef struct {
+    js_map_t* map;
+    VAL callback;
+    VAL this;
+    bool set;
+} for_each_state_t;
+
+static void for_each_entry(void* state)
+{
+    for_each_state_t* s = state;
+    uint32_t cursor = 0;
+    VAL key, value;
+    while(js_valtable_next(s->map->table, &cursor, &key, &value)) {
+        VAL args[] = { s->set ? key : value, key, js_value_make_pointer((js_value_t*)s->map) };
+        js_call(s->callback, s->this, 3, args);
+    }
+}
+
+static void for_each(js_vm_t* vm, js_map_t* map, bool set, uint32_t argc, VAL* argv)
+{
+    for_each_state_t state;
+    VAL exception;
+    bool ok;
+    if(argc == 0 || js_value_get_type(argv[0]) != JS_T_FUNCTION) {
+        js_throw_error(vm->lib.TypeError, "forEach() expects a function");
+    }
+    state.map = map;
+    state.set = set;
+    state.callback = argv[0];
+    state.this = argc > 1 ? argv[1] : js_value_undefined();
+    // keeps entries from being compacted underneath the loop if the callback adds any:
+    map->table->iterating++;
+    ok = js_try(&state, for_each_entry, &exception);
+    map->table->iterating--;
+    if(!ok) {
+        js_throw(exception);
+    }
+}
+
+/* copies out keys (which for a set are also the values) or values as an array */
+static VAL to_array(js_vm_t* vm, js_map_t* map, bool keys)
+{
+    VAL* items = js_alloc(sizeof(VAL) * (map->table->count < 4 ? 4 : map->table->count));
+    uint32_t cursor = 0, count = 0;
+    VAL key, value;
+    while(js_valtable_next(map->table, &cursor, &key, &value)) {
+        items[count++] = keys ? key : value;
+    }
+    return js_make_array(vm, count, items);
+}
+
+static VAL Map_call(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_throw_error(vm->lib.TypeError, "Map must be called with new");
+}
+
+static VAL Map_construct(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    VAL map = make_map(vm, vm->lib.Map_prototype, vm->lib.Map);
+    VAL* pairs;
+    uint32_t count, i;
+    if(argc > 0 && js_value_get_type(argv[0]) != JS_T_UNDEFINED && js_value_get_type(argv[0]) != JS_T_NULL) {
+        // there's no iteration protocol to speak of, so entries come in an array of [key, value] pairs:
+        if(js_value_get_type(argv[0]) != JS_T_ARRAY) {
+            js_throw_error(vm->lib.TypeError, "Map expects an array of [key, value] pairs");
+        }
+        pairs = js_array_items(argv[0], &count);
+        for(i = 0; i < count; i++) {
+            if(js_value_is_primitive(pairs[i])) {
+                js_throw_error(vm->lib.TypeError, "Map expects an array of [key, value] pairs");
+            }
+            js_valtable_insert(((js_map_t*)js_value_get_pointer(map))->table, js_object_get_index(pairs[i], 0), js_object_get_index(pairs[i], 1));
+        }
+    }
+    return map;
+}
+
+static VAL Map_prototype_get(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_map_t* map = get_map(vm, this, vm->lib.Map, "Map", "get");
+    VAL value;
+    if(argc > 0 && js_valtable_lookup(map->table, argv[0], &value)) {
+        return value;
+    }
+    return js_value_undefined();
+}
+
+static VAL Map_prototype_set(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_map_t* map = get_map(vm, this, vm->lib.Map, "Map", "set");
+    js_valtable_insert(map->table, argc > 0 ? argv[0] : js_value_undefined(), argc > 1 ? argv[1] : js_value_undefined());
+    return this;
+}
+
+static VAL Map_prototype_has(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_map_t* map = get_map(vm, this, vm->lib.Map, "Map", "has");
+    return js_value_make_boolean(js_valtable_lookup(map->table, argc > 0 ? argv[0] : js_value_undefined(), NULL));
+}
+
+static VAL Map_prototype_delete(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_map_t* map = get_map(vm, this, vm->lib.Map, "Map", "delete");
+    return js_value_make_boolean(js_valtable_delete(map->table, argc > 0 ? argv[0] : js_value_undefined()));
+}
+
+static VAL Map_prototype_clear(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_valtable_clear(get_map(vm, this, vm->lib.Map, "Map", "clear")->table);
+    return js_value_undefined();
+}
+
+static VAL Map_prototype_forEach(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    for_each(vm, get_map(vm, this, vm->lib.Map, "Map", "forEach"), false, argc, argv);
+    return js_value_undefined();
+}
+
+static VAL Map_prototype_keys(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    return to_array(vm, get_map(vm, this, vm->lib.Map, "Map", "keys"), true);
+}
+
+static VAL Map_prototype_values(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    return to_array(vm, get_map(vm, this, vm->lib.Map, "Map", "values"), false);
+}
+
+static VAL Map_prototype_size(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    return js_value_make_double(get_map(vm, this, vm->lib.Map, "Map", "size")->table->count);
+}
+
+static VAL Set_call(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_throw_error(vm->lib.TypeError, "Set must be called with new");
+}
+
+static VAL Set_construct(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    VAL set = make_map(vm, vm->lib.Set_prototype, vm->lib.Set);
+    VAL* items;
+    uint32_t count, i;
+    if(argc > 0 && js_value_get_type(argv[0]) != JS_T_UNDEFINED && js_value_get_type(argv[0]) != JS_T_NULL) {
+        if(js_value_get_type(argv[0]) != JS_T_ARRAY) {
+            js_throw_error(vm->lib.TypeError, "Set expects an array");
+        }
+        items = js_array_items(argv[0], &count);
+        for(i = 0; i < count; i++) {
+            js_valtable_insert(((js_map_t*)js_value_get_pointer(set))->table, items[i], items[i]);
+        }
+    }
+    return set;
+}
+
+static VAL Set_prototype_add(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_map_t* set = get_map(vm, this, vm->lib.Set, "Set", "add");
+    VAL value = argc > 0 ? argv[0] : js_value_undefined();
+    js_valtable_insert(set->table, value, value);
+    return this;
+}
+
+static VAL Set_prototype_has(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_map_t* set = get_map(vm, this, vm->lib.Set, "Set", "has");
+    return js_value_make_boolean(js_valtable_lookup(set->table, argc > 0 ? argv[0] : js_value_undefined(), NULL));
+}
+
+static VAL Set_prototype_delete(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_map_t* set = get_map(vm, this, vm->lib.Set, "Set", "delete");
+    return js_value_make_boolean(js_valtable_delete(set->table, argc > 0 ? argv[0] : js_value_undefined()));
+}
+
+static VAL Set_prototype_clear(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_valtable_clear(get_map(vm, this, vm->lib.Set, "Set", "clear")->table);
+    return js_value_undefined();
+}
+
+static VAL Set_prototype_forEach(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    for_each(vm, get_map(vm, this, vm->lib.Set, "Set", "forEach"), true, argc, argv);
+    return js_value_undefined();
+}
+
+static VAL Set_prototype_values(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    return to_array(vm, get_map(vm, this, vm->lib.Set, "Set", "values"), true);
+}
+
+static VAL Set_prototype_size(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    return js_value_make_double(get_map(vm, this, vm->lib.Set, "Set", "size")->table->count);
+}
+
+VAL js_make_map(js_vm_t* vm)
+{
+    return make_map(vm, vm->lib.Map_prototype, vm->lib.Map);
+}
+
+js_valtable_t* js_map_table(js_vm_t* vm, VAL map)
+{
+    js_value_t* class;
+    if(!js_value_is_object(map)) {
+        js_panic("non map passed to js_map_table");
+    }
+    class = js_value_get_pointer(js_value_get_pointer(map)->object.class);
+    if(class != js_value_get_pointer(vm->lib.Map) && class != js_value_get_pointer(vm->lib.Set)) {
+        js_panic("non map passed to js_map_table");
+    }
+    return ((js_map_t*)js_value_get_pointer(map))->table;
+}
+
+void js_lib_map_initialize(js_vm_t* vm)
+{
+    vm->lib.Map = js_value_make_native_function(vm, NULL, js_cstring("Map"), Map_call, Map_construct);
+    js_object_put(vm->global_scope->global_object, js_cstring("Map"), vm->lib.Map);
+
+    vm->lib.Map_prototype = js_value_make_object(vm->lib.Object_prototype, vm->lib.Map);
+    js_object_put(vm->lib.Map, js_cstring("prototype"), vm->lib.Map_prototype);
+
+    js_object_put(vm->lib.Map_prototype, js_cstring("get"), js_value_make_native_function(vm, NULL, js_cstring("get"), Map_prototype_get, NULL));
+    js_object_put(vm->lib.Map_prototype, js_cstring("set"), js_value_make_native_function(vm, NULL, js_cstring("set"), Map_prototype_set, NULL));
+    js_object_put(vm->lib.Map_prototype, js_cstring("has"), js_value_make_native_function(vm, NULL, js_cstring("has"), Map_prototype_has, NULL));
+    js_object_put(vm->lib.Map_prototype, js_cstring("delete"), js_value_make_native_function(vm, NULL, js_cstring("delete"), Map_prototype_delete, NULL));
+    js_object_put(vm->lib.Map_prototype, js_cstring("clear"), js_value_make_native_function(vm, NULL, js_cstring("clear"), Map_prototype_clear, NULL));
+    js_object_put(vm->lib.Map_prototype, js_cstring("forEach"), js_value_make_native_function(vm, NULL, js_cstring("forEach"), Map_prototype_forEach, NULL));
+    js_object_put(vm->lib.Map_prototype, js_cstring("keys"), js_value_make_native_function(vm, NULL, js_cstring("keys"), Map_prototype_keys, NULL));
+    js_object_put(vm->lib.Map_prototype, js_cstring("values"), js_value_make_native_function(vm, NULL, js_cstring("values"), Map_prototype_values, NULL));
+    js_object_put_accessor(vm, vm->lib.Map_prototype, "size", Map_prototype_size, NULL);
+
+    vm->lib.Set = js_value_make_native_function(vm, NULL, js_cstring("Set"), Set_call, Set_construct);
+    js_object_put(vm->global_scope->global_object, js_cstring("Set"), vm->lib.Set);
+
+    vm->lib.Set_prototype = js_value_make_object(vm->lib.Object_prototype, vm->lib.Set);
+    js_object_put(vm->lib.Set, js_cstring("prototype"), vm->lib.Set_prototype);
+
+    js_object_put(vm->lib.Set_prototype, js_cstring("add"), js_value_make_native_function(vm, NULL, js_cstring("add"), Set_prototype_add, NULL));
+    js_object_put(vm->lib.Set_prototype, js_cstring("has"), js_value_make_native_function(vm, NULL, js_cstring("has"), Set_prototype_has, NULL));
+    js_object_put(vm->lib.Set_prototype, js_cstring("delete"), js_value_make_native_function(vm, NULL, js_cstring("delete"), Set_prototype_delete, NULL));
+    js_object_put(vm->lib.Set_prototype, js_cstring("clear"), js_value_make_native_function(vm, NULL, js_cstring("clear"), Set_prototype_clear, NULL));
+    js_object_put(vm->lib.Set_prototype, js_cstring("forEach"), js_value_make_native_function(vm, NULL, js_cstring("forEach"), Set_prototype_forEach, NULL));
+    js_object_put(vm->lib.Set_prototype, js_cstring("values"), js_value_make_native_function(vm, NULL, js_cstring("values"), Set_prototype_values, NULL));
+    js_object_put(vm->lib.Set_prototype, js_cstring("keys"), js_object_get(vm->lib.Set_prototype, js_cstring("values")));
+    js_object_put_accessor(vm, vm->lib.Set_prototype, "size", Set_prototype_size, NULL);
+}
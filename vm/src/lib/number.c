@@ -7,6 +7,7 @@
 #include "object.h"
 #include "gc.h"
 #include "exception.h"
+#include "dtoa.h"
 
 typedef struct {
     js_value_t base;
@@ -38,7 +39,7 @@ VAL js_make_number_object(js_vm_t* vm, double number)
     num->base.object.vtable = js_object_base_vtable();
     num->base.object.prototype = vm->lib.Number_prototype;
     num->base.object.class = vm->lib.Number;
-    num->base.object.properties = js_st_table_new();
+    num->base.object.properties = js_proptable_new();
     num->number = number;
     return js_value_make_pointer((js_value_t*)num);
 }
@@ -74,121 +75,141 @@ void js_lib_number_initialize(js_vm_t* vm)
 
 static bool is_char_whitespace(char c)
 {
-    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
 }
 
-double js_number_parse(js_string_t* str)
+static double parse_hex(char* ptr, char* end)
 {
-    // parse str according to ECMA-262 Section 9.3.1
     double number = 0;
-    double frac = 0.1;
-    int exponent = 0;
-    bool neg = false, negexp = false;
-    uint32_t i;
-    for(i = 0; i < str->length; i++) {
-        if(!is_char_whitespace(str->buff[i])) {
+    if(ptr == end) {
+        return NAN;
+    }
+    for(; ptr < end; ptr++) {
+        number *= 16;
+        if(*ptr >= '0' && *ptr <= '9') {
+            number += *ptr - '0';
+        } else if(*ptr >= 'a' && *ptr <= 'f') {
+            number += 10 + *ptr - 'a';
+        } else if(*ptr >= 'A' && *ptr <= 'F') {
+            number += 10 + *ptr - 'A';
+        } else {
+            return NAN;
+        }
+    }
+    return number;
+}
+
+static double parse_decimal(char* ptr, char* end)
+{
+    // significant digits are collected without the leading zeroes or the decimal
+    // point, as the value 0.digits * 10^point:
+    char digits[JS_DTOA_MAX_PARSE_DIGITS + 1];
+    uint32_t count = 0;
+    int32_t point = 0, exponent = 0;
+    bool any_digits = false, truncated = false, fraction = false;
+    for(; ptr < end; ptr++) {
+        if(*ptr >= '0' && *ptr <= '9') {
+            any_digits = true;
+            if(count == 0 && *ptr == '0') {
+                point -= fraction;
+                continue;
+            }
+            if(count < JS_DTOA_MAX_PARSE_DIGITS) {
+                digits[count++] = *ptr;
+            } else if(*ptr != '0') {
+                truncated = true;
+            }
+            point += !fraction;
+        } else if(*ptr == '.' && !fraction) {
+            fraction = true;
+        } else {
             break;
         }
     }
-    if(i == str->length) {
+    if(!any_digits) {
         return NAN;
     }
-    if(str->buff[i] == '0' && i + 1 < str->length && (str->buff[i + 1] == 'x' || str->buff[i + 1] == 'X')) {
-        // hex number:
-        i += 2;
-        if(i == str->length) return NAN;
-        for(; i < str->length; i++) {
-            number *= 16;
-            if(str->buff[i] >= '0' && str->buff[i] <= '9') {
-                number += str->buff[i] - '0';
-            } else if(str->buff[i] >= 'a' && str->buff[i] <= 'f') {
-                number += 10 + str->buff[i] - 'a';
-            } else if(str->buff[i] >= 'A' && str->buff[i] <= 'F') {
-                number += 10 + str->buff[i] - 'A';
-            } else if(is_char_whitespace(str->buff[i])) {
-                goto whitespace_only;
-            } else {
-                return NAN;
-            }
-        }
-    } else {
-        if(i + 8 <= str->length && memcmp(str->buff + i, "Infinity", 8) == 0) {
-            number = INFINITY;
-            goto whitespace_only;
-        }
-        if(str->buff[i] == '-') {
-            neg = true;
-            i++;
+    if(ptr < end) {
+        bool negative_exponent = false;
+        if(*ptr != 'e' && *ptr != 'E') {
+            return NAN;
         }
-        if(str->buff[i] == '+') {
-            i++;
+        ptr++;
+        if(ptr < end && (*ptr == '+' || *ptr == '-')) {
+            negative_exponent = *ptr == '-';
+            ptr++;
         }
-        if(i == str->length) {
+        if(ptr == end) {
             return NAN;
         }
-        for(; i < str->length; i++) {
-            if(str->buff[i] >= '0' && str->buff[i] <= '9') {
-                number *= 10;
-                number += str->buff[i] - '0';
-            } else {
-                break;
+        for(; ptr < end; ptr++) {
+            if(*ptr < '0' || *ptr > '9') {
+                return NAN;
             }
-        }
-        if(i == str->length) {
-            return (neg ? -1.0 : 1.0) * number;
-        }
-        if(str->buff[i] == '.') {
-            i++;
-            for(; i < str->length; i++) {
-                if(str->buff[i] >= '0' && str->buff[i] <= '9') {
-                    number += (str->buff[i] - '0') * frac;
-                    frac /= 10.0;
-                } else {
-                    break;
-                }
+            // anything this big is already out of range either way:
+            if(exponent < 100000) {
+                exponent = exponent * 10 + (*ptr - '0');
             }
         }
-        if(i == str->length) {
-            return (neg ? -1.0 : 1.0) * number;
+        point += negative_exponent ? -exponent : exponent;
+    }
+    if(count == 0) {
+        return 0;
+    }
+    if(truncated) {
+        digits[count++] = '1';
+    }
+    return js_dtoa_parse(digits, count, point);
+}
+
+double js_number_parse(js_string_t* str)
+{
+    // parse str according to ECMA-262 Section 9.3.1
+    char* ptr = str->buff;
+    char* end = str->buff + str->length;
+    double number;
+    bool neg = false;
+    uint32_t i, small = 0;
+    if(str->number_cached) {
+        return str->number;
+    }
+    if(str->length > 0 && str->length <= 9) {
+        // short strings of digits are most of what gets turned into numbers, and
+        // they fit in 32 bits:
+        for(i = 0; i < str->length && str->buff[i] >= '0' && str->buff[i] <= '9'; i++) {
+            small = small * 10 + (str->buff[i] - '0');
         }
-        if(str->buff[i] == 'e' || str->buff[i] == 'E') {
-            i++;
-            if(i < str->length) {
-                if(str->buff[i] == '+') {
-                    i++;
-                } else if(str->buff[i] == '-') {
-                    negexp = true;
-                    i++;
-                }
-            }
-            for(; i < str->length; i++) {
-                if(str->buff[i] >= '0' && str->buff[i] <= '9') {
-                    exponent *= 10;
-                    exponent += str->buff[i] - '0';
-                } else {
-                    break;
-                }
-            }
-            if(negexp) {
-                exponent = -exponent;
-            }
-            while(exponent > 0) {
-                number *= 10.0;
-                exponent--;
-            }
-            while(exponent < 0) {
-                number /= 10.0;
-                exponent++;
-            }
-            goto whitespace_only;
+        if(i == str->length) {
+            number = small;
+            goto done;
         }
     }
-    
-whitespace_only:
-    while(i < str->length) {
-        if(!is_char_whitespace(str->buff[i])) {
-            return NAN;
+    while(ptr < end && is_char_whitespace(*ptr)) {
+        ptr++;
+    }
+    while(end > ptr && is_char_whitespace(end[-1])) {
+        end--;
+    }
+    if(ptr == end) {
+        number = 0;
+    } else if(end - ptr > 2 && ptr[0] == '0' && (ptr[1] == 'x' || ptr[1] == 'X')) {
+        number = parse_hex(ptr + 2, end);
+    } else {
+        if(*ptr == '-' || *ptr == '+') {
+            neg = *ptr == '-';
+            ptr++;
+        }
+        if(end - ptr == 8 && memcmp(ptr, "Infinity", 8) == 0) {
+            number = INFINITY;
+        } else {
+            number = parse_decimal(ptr, end);
+        }
+        if(neg) {
+            number = -number;
         }
     }
-    return (neg ? -1.0 : 1.0) * number;
-}
\ No newline at end of file
+done:
+    str->number = number;
+    str->number_cached = true;
+    return number;
+}
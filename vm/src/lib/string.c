@@ -43,7 +43,7 @@ VAL js_make_string_object(js_vm_t* vm, js_string_t* string)
     str->base.object.vtable = &string_vtable;
     str->base.object.prototype = vm->lib.String_prototype;
     str->base.object.class = vm->lib.String;
-    str->base.object.properties = js_st_table_new();
+    str->base.object.properties = js_proptable_new();
     str->string.buff = string->buff;
     str->string.length = string->length;
     VAL v = js_value_make_pointer((js_value_t*)str);
@@ -76,6 +76,15 @@ static VAL string_vtable_get(js_value_t* obj, js_string_t* prop)
     return js_object_base_vtable()->get(obj, prop);
 }
 
+static VAL string_vtable_get_index(js_value_t* obj, uint32_t index)
+{
+    js_string_object_t* str = (js_string_object_t*)obj;
+    if(index < str->string.length) {
+        return js_value_make_string(&str->string.buff[index], 1);
+    }
+    return js_object_base_vtable()->get_index(obj, index);
+}
+
 static VAL String_fromCharCode(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
 {
     js_value_t* val = js_alloc(sizeof(js_value_t));
@@ -177,10 +186,21 @@ static VAL String_prototype_split(js_vm_t* vm, void* state, VAL this, uint32_t a
         return js_make_array(vm, 1, &this);
     }
     js_string_t* delimiter = js_to_js_string_t(argv[0]);
+    js_string_t* str = &((js_string_object_t*)js_value_get_pointer(this))->string;
     uint32_t capacity = 4;
     uint32_t count = 0;
-    VAL* items = js_alloc(sizeof(VAL) * 4);
-    js_string_t remaining = ((js_string_object_t*)js_value_get_pointer(this))->string;
+    VAL* items;
+    if(delimiter->length == 0) {
+        // every character on its own:
+        uint32_t i;
+        items = js_alloc(sizeof(VAL) * (str->length ? str->length : 1));
+        for(i = 0; i < str->length; i++) {
+            items[count++] = js_value_make_string(str->buff + i, 1);
+        }
+        return js_make_array(vm, count, items);
+    }
+    items = js_alloc(sizeof(VAL) * capacity);
+    js_string_t remaining = *str;
     uint32_t index;
     while(js_string_index_of(&remaining, delimiter, &index)) {
         if(count + 1 == capacity) {
@@ -247,6 +267,7 @@ void js_lib_string_initialize(js_vm_t* vm)
         statically_initialized = true;
         memcpy(&string_vtable, js_object_base_vtable(), sizeof(js_object_internal_methods_t));
         string_vtable.get = string_vtable_get;
+        string_vtable.get_index = string_vtable_get_index;
     }
     
     vm->lib.String = js_value_make_native_function(vm, NULL, js_cstring("String"), String_call, String_construct);
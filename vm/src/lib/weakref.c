@@ -0,0 +1,60 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "lib.h"
+#include "object.h"
+#include "gc.h"
+#include "exception.h"
+
+typedef struct {
+    js_value_t base;
+    void** cell;
+} js_weakref_t;
+
+static js_weakref_t* get_weakref(js_vm_t* vm, VAL this, char* method)
+{
+    if(!js_value_is_object(this) || js_value_get_pointer(js_value_get_pointer(this)->object.class) != js_value_get_pointer(vm->lib.WeakRef)) {
+        js_throw_error(vm->lib.TypeError, "WeakRef.prototype.%s() is not generic", method);
+    }
+    return (js_weakref_t*)js_value_get_pointer(this);
+}
+
+static VAL WeakRef_call(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_throw_error(vm->lib.TypeError, "WeakRef must be called with new");
+}
+
+static VAL WeakRef_construct(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_weakref_t* ref;
+    if(argc == 0 || !js_value_is_object(argv[0])) {
+        js_throw_error(vm->lib.TypeError, "WeakRef target must be an object");
+    }
+    ref = js_alloc(sizeof(js_weakref_t));
+    ref->base.type = JS_T_OBJECT;
+    ref->base.object.vtable = js_object_base_vtable();
+    ref->base.object.prototype = vm->lib.WeakRef_prototype;
+    ref->base.object.class = vm->lib.WeakRef;
+    ref->base.object.properties = js_proptable_new();
+    ref->cell = js_gc_weak_new(js_value_get_pointer(argv[0]));
+    return js_value_make_pointer((js_value_t*)ref);
+}
+
+static VAL WeakRef_prototype_deref(js_vm_t* vm, void* state, VAL this, uint32_t argc, VAL* argv)
+{
+    js_weakref_t* ref = get_weakref(vm, this, "deref");
+    if(*ref->cell == NULL) {
+        return js_value_undefined();
+    }
+    return js_value_make_pointer(*ref->cell);
+}
+
+void js_lib_weakref_initialize(js_vm_t* vm)
+{
+    vm->lib.WeakRef = js_value_make_native_function(vm, NULL, js_cstring("WeakRef"), WeakRef_call, WeakRef_construct);
+    js_object_put(vm->global_scope->global_object, js_cstring("WeakRef"), vm->lib.WeakRef);
+    
+    vm->lib.WeakRef_prototype = js_value_make_object(vm->lib.Object_prototype, vm->lib.WeakRef);
+    js_object_put(vm->lib.WeakRef, js_cstring("prototype"), vm->lib.WeakRef_prototype);
+    
+    js_object_put(vm->lib.WeakRef_prototype, js_cstring("deref"), js_value_make_native_function(vm, NULL, js_cstring("deref"), WeakRef_prototype_deref, NULL));
+}
@@ -1,7 +1,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include "object.h"
-#include "st.h"
+#include "proptable.h"
+#include "elements.h"
 #include "gc.h"
 #include "vm.h"
 #include "exception.h"
@@ -17,42 +18,65 @@ int js_string_cmp(js_string_t* a, js_string_t* b)
     return memcmp(a->buff, b->buff, a->length);
 }
 
-static int js_string_hash(js_string_t* str)
-{
-    int val = 0;
-    uint32_t i;
-    for(i = 0; i < str->length; i++) {
-        val += str->buff[i];
-        val += (str->buff[i] << 10);
-        val ^= (str->buff[i] >> 6);
-    }
-    val += (val << 3);
-    val ^= (val >> 11);
-    return val + (val << 15);
-}
+/* a global cache of prototype chain lookups, keyed on the receiver's prototype and the
+   address of the property name's characters. names nearly always come straight out of
+   an image's constant pool, so a given call site looks up the same characters every
+   time even if the js_string_t wrapping them is new. an entry is only good for the
+   js_proptable_epoch it was made in. the cache isn't a gc root, so js_gc_run bumps the
+   epoch before anything an entry points at can be freed and have its address reused */
+#define LOOKUP_CACHE_SIZE 1024
 
-static struct st_hash_type js_string_st_type = {
-    js_string_cmp,
-    js_string_hash
-};
+typedef struct {
+    js_value_t* prototype;
+    char* name;
+    uint32_t length;
+    js_property_descriptor_t* descr; // NULL if nothing on the chain has the property
+    uint32_t epoch;
+} lookup_cache_entry_t;
 
-st_table* js_st_table_new()
-{
-    return st_init_table(&js_string_st_type);
-}
+static lookup_cache_entry_t lookup_cache[LOOKUP_CACHE_SIZE];
+static uint64_t lookup_cache_hits;
+static uint64_t lookup_cache_misses;
 
-static VAL js_object_base_get(js_value_t* obj, js_string_t* prop)
+static js_property_descriptor_t* js_object_prototype_lookup(js_value_t* prototype, js_string_t* prop)
 {
+    lookup_cache_entry_t* entry = &lookup_cache[(((intptr_t)prototype >> 3) ^ ((intptr_t)prop->buff >> 2) * 31) & (LOOKUP_CACHE_SIZE - 1)];
     js_property_descriptor_t* descr = NULL;
-    js_value_t* this = obj;
-    while(!st_lookup(obj->object.properties, (st_data_t)prop, (st_data_t*)&descr)) {
-        /* if not in object, look in prototype */
+    js_value_t* obj = prototype;
+    if(entry->prototype == prototype && entry->name == prop->buff && entry->length == prop->length && entry->epoch == js_proptable_epoch) {
+        lookup_cache_hits++;
+        return entry->descr;
+    }
+    lookup_cache_misses++;
+    while(true) {
+        // changes to this object now have to invalidate the cache:
+        obj->object.properties->prototype = true;
+        if(js_proptable_lookup(obj->object.properties, prop, (void**)&descr)) {
+            break;
+        }
         if(js_value_is_primitive(obj->object.prototype)) {
             /* do not attempt if prototype is primitive */
-            return js_value_undefined();
+            descr = NULL;
+            break;
         }
         obj = js_value_get_pointer(obj->object.prototype);
     }
+    entry->prototype = prototype;
+    entry->name = prop->buff;
+    entry->length = prop->length;
+    entry->descr = descr;
+    entry->epoch = js_proptable_epoch;
+    return descr;
+}
+
+void js_object_lookup_cache_stats(uint64_t* hits, uint64_t* misses)
+{
+    *hits = lookup_cache_hits;
+    *misses = lookup_cache_misses;
+}
+
+static VAL descriptor_get(js_value_t* this, js_property_descriptor_t* descr)
+{
     if(!descr->is_accessor) {
         return descr->data.value;
     } else {
@@ -63,19 +87,97 @@ static VAL js_object_base_get(js_value_t* obj, js_string_t* prop)
     }
 }
 
-static void js_object_base_put(js_value_t* obj, js_string_t* prop, VAL value)
+static void descriptor_put(js_value_t* this, js_property_descriptor_t* descr, VAL value)
+{
+    if(!descr->is_accessor) {
+        if(descr->data.writable) {
+            descr->data.value = value;
+        }
+    } else {
+        if(js_value_get_type(descr->accessor.set) == JS_T_FUNCTION) {
+            js_call(descr->accessor.set, js_value_make_pointer(this), 1, &value);
+        }
+    }
+}
+
+/* array index keys usually live in the object's elements, but ones with unusual
+   descriptors go in the property table. prop is the key as a string if the caller
+   already has it, or NULL */
+static VAL get_index(js_value_t* obj, uint32_t index, js_string_t* prop)
 {
     js_property_descriptor_t* descr = NULL;
-    if(st_lookup(obj->object.properties, (st_data_t)prop, (st_data_t*)&descr)) {
-        if(!descr->is_accessor) {
-            if(descr->data.writable) {
-                descr->data.value = value;
-            }
-        } else {
-            if(js_value_get_type(descr->accessor.set) == JS_T_FUNCTION) {
-                js_call(descr->accessor.set, js_value_make_pointer(obj), 1, &value);
-            }
+    VAL value;
+    if(js_elements_get(obj->object.elements, index, &value)) {
+        return value;
+    }
+    if(obj->object.properties->indexed) {
+        if(prop == NULL) {
+            prop = js_string_from_index(index);
+        }
+        if(js_proptable_lookup(obj->object.properties, prop, (void**)&descr)) {
+            return descriptor_get(obj, descr);
+        }
+    }
+    if(js_value_is_primitive(obj->object.prototype)) {
+        return js_value_undefined();
+    }
+    return js_object_get_index(obj->object.prototype, index);
+}
+
+static void put_index(js_value_t* obj, uint32_t index, js_string_t* prop, VAL value)
+{
+    js_property_descriptor_t* descr = NULL;
+    if(obj->object.properties->indexed) {
+        if(prop == NULL) {
+            prop = js_string_from_index(index);
+        }
+        if(js_proptable_lookup(obj->object.properties, prop, (void**)&descr)) {
+            descriptor_put(obj, descr, value);
+            return;
         }
+    }
+    if(obj->object.elements == NULL) {
+        obj->object.elements = js_elements_new();
+    }
+    js_elements_put(obj->object.elements, index, value);
+}
+
+static VAL js_object_base_get(js_value_t* obj, js_string_t* prop)
+{
+    js_property_descriptor_t* descr = NULL;
+    uint32_t index;
+    if(js_string_to_index(prop, &index)) {
+        return get_index(obj, index, prop);
+    }
+    if(!js_proptable_lookup(obj->object.properties, prop, (void**)&descr)) {
+        /* if not in object, look in prototype */
+        if(js_value_is_primitive(obj->object.prototype)) {
+            /* do not attempt if prototype is primitive */
+            return js_value_undefined();
+        }
+        descr = js_object_prototype_lookup(js_value_get_pointer(obj->object.prototype), prop);
+        if(descr == NULL) {
+            return js_value_undefined();
+        }
+    }
+    return descriptor_get(obj, descr);
+}
+
+static VAL js_object_base_get_index(js_value_t* obj, uint32_t index)
+{
+    return get_index(obj, index, NULL);
+}
+
+static void js_object_base_put(js_value_t* obj, js_string_t* prop, VAL value)
+{
+    js_property_descriptor_t* descr = NULL;
+    uint32_t index;
+    if(js_string_to_index(prop, &index)) {
+        put_index(obj, index, prop, value);
+        return;
+    }
+    if(js_proptable_lookup(obj->object.properties, prop, (void**)&descr)) {
+        descriptor_put(obj, descr, value);
         return;
     }
     descr = js_alloc(sizeof(js_property_descriptor_t));
@@ -84,13 +186,23 @@ static void js_object_base_put(js_value_t* obj, js_string_t* prop, VAL value)
     descr->configurable = true;
     descr->data.value = value;
     descr->data.writable = true;
-    st_insert(obj->object.properties, (st_data_t)prop, (st_data_t)descr);
+    js_proptable_insert(obj->object.properties, prop, descr);
+}
+
+static void js_object_base_put_index(js_value_t* obj, uint32_t index, VAL value)
+{
+    put_index(obj, index, NULL, value);
 }
 
 static bool js_object_base_has_property(js_value_t* obj, js_string_t* prop)
 {
     js_property_descriptor_t* descr = NULL;
-    if(st_lookup(obj->object.properties, (st_data_t)prop, (st_data_t*)&descr)) {
+    uint32_t index;
+    VAL value;
+    if(js_string_to_index(prop, &index) && js_elements_get(obj->object.elements, index, &value)) {
+        return true;
+    }
+    if(js_proptable_lookup(obj->object.properties, prop, (void**)&descr)) {
         return true;
     }
     return false;
@@ -143,43 +255,104 @@ static VAL js_object_base_default_value(js_value_t* obj, js_type_t preferred_typ
 static bool js_object_base_define_own_property(js_value_t* obj, js_string_t* prop, js_property_descriptor_t* new_descr)
 {
     js_property_descriptor_t* old_descr = NULL;
-    if(st_lookup(obj->object.properties, (st_data_t)prop, (st_data_t*)&old_descr)) {
+    uint32_t index;
+    if(js_string_to_index(prop, &index) && !js_proptable_lookup(obj->object.properties, prop, NULL)) {
+        if(!new_descr->is_accessor && new_descr->data.writable && new_descr->enumerable && new_descr->configurable) {
+            put_index(obj, index, prop, new_descr->data.value);
+            return true;
+        }
+        // elements can only hold plain values, so this one moves to the property table:
+        js_elements_delete(obj->object.elements, index);
+        obj->object.properties->indexed = true;
+    }
+    if(js_proptable_lookup(obj->object.properties, prop, (void**)&old_descr)) {
         if(!old_descr->configurable) {
             return false;
         }
     }
-    st_insert(obj->object.properties, (st_data_t)prop, (st_data_t)new_descr);
+    js_proptable_insert(obj->object.properties, prop, new_descr);
     return true;
 }
 
 static bool js_object_base_delete(js_value_t* obj, js_string_t* prop)
 {
-    st_data_t tmp;
-    st_delete(obj->object.properties, (st_data_t*)&prop, &tmp);
+    uint32_t index;
+    if(js_string_to_index(prop, &index)) {
+        js_elements_delete(obj->object.elements, index);
+    }
+    js_proptable_delete(obj->object.properties, prop);
     return true;
 }
 
-struct key_iter {
-    js_string_t** keys;
-    uint32_t index;
-};
-
-static int js_object_base_keys_iter(st_data_t key, st_data_t record, st_data_t arg)
+/* the object's own enumerable index keys in ascending order */
+static uint32_t* own_indices(js_value_t* obj, uint32_t* count)
 {
-    struct key_iter* state = (struct key_iter*)arg;
-    js_property_descriptor_t* descr = (js_property_descriptor_t*)record;
-    if(descr->enumerable) {
-        state->keys[state->index++] = (js_string_t*)key;
+    js_proptable_t* properties = obj->object.properties;
+    uint32_t* indices = js_elements_indices(obj->object.elements, count);
+    uint32_t index, cursor = 0;
+    js_string_t* key;
+    js_property_descriptor_t* descr;
+    if(properties->indexed) {
+        indices = js_realloc(indices, sizeof(uint32_t) * (*count + properties->count));
+        while(js_proptable_next(properties, &cursor, &key, (void**)&descr)) {
+            if(descr->enumerable && js_string_to_index(key, &index)) {
+                indices[(*count)++] = index;
+            }
+        }
+        js_elements_sort_indices(indices, *count);
     }
-    return ST_CONTINUE;
+    return indices;
 }
 
 static js_string_t** js_object_base_keys(js_value_t* obj, uint32_t* count)
 {
-    struct key_iter state = { js_alloc(sizeof(js_string_t*) * obj->object.properties->num_entries), 0 };
-    st_foreach(obj->object.properties, js_object_base_keys_iter, (st_data_t)&state);
-    *count = state.index;
-    return state.keys;
+    js_proptable_t* properties = obj->object.properties;
+    uint32_t* indices;
+    uint32_t index_count, index, i, cursor = 0;
+    js_string_t** keys;
+    js_string_t* key;
+    js_property_descriptor_t* descr;
+    // array indices come first in ascending order, then everything else in insertion order:
+    indices = own_indices(obj, &index_count);
+    keys = js_alloc(sizeof(js_string_t*) * (index_count + properties->count));
+    for(i = 0; i < index_count; i++) {
+        keys[i] = js_string_from_index(indices[i]);
+    }
+    *count = index_count;
+    while(js_proptable_next(properties, &cursor, &key, (void**)&descr)) {
+        if(descr->enumerable && !(properties->indexed && js_string_to_index(key, &index))) {
+            keys[(*count)++] = key;
+        }
+    }
+    return keys;
+}
+
+static bool js_object_base_next_index(js_value_t* obj, uint32_t* index, js_index_cursor_t* cursor)
+{
+    js_property_descriptor_t* descr;
+    uint32_t candidate;
+    VAL value;
+    if(cursor->indices == NULL && !obj->object.properties->indexed
+        && (obj->object.elements == NULL || !obj->object.elements->sparse)) {
+        // the elements are in order already:
+        return js_elements_next(obj->object.elements, index);
+    }
+    if(cursor->indices == NULL) {
+        cursor->indices = own_indices(obj, &cursor->count);
+    }
+    while(cursor->position < cursor->count) {
+        candidate = cursor->indices[cursor->position++];
+        if(candidate < *index) {
+            continue;
+        }
+        // skip over anything deleted since:
+        if(js_elements_get(obj->object.elements, candidate, &value)
+            || (js_proptable_lookup(obj->object.properties, js_string_from_index(candidate), (void**)&descr) && descr->enumerable)) {
+            *index = candidate;
+            return true;
+        }
+    }
+    return false;
 }
 
 static js_object_internal_methods_t object_base_vtable = {
@@ -193,6 +366,9 @@ static js_object_internal_methods_t object_base_vtable = {
     /* default_value */         js_object_base_default_value,
     /* define_own_property */   js_object_base_define_own_property,
     /* keys */                  js_object_base_keys,
+    /* get_index */             js_object_base_get_index,
+    /* put_index */             js_object_base_put_index,
+    /* next_index */            js_object_base_next_index,
     // @TODO: ^^ all those
 };
 
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <string.h>
+#include "proptable.h"
+#include "gc.h"
+
+uint32_t js_proptable_epoch = 1;
+
+uint32_t js_string_hash(js_string_t* str)
+{
+    uint32_t val = 0;
+    uint32_t i;
+    if(str->hash) {
+        return str->hash;
+    }
+    for(i = 0; i < str->length; i++) {
+        val += (uint8_t)str->buff[i];
+        val += (val << 10);
+        val ^= (val >> 6);
+    }
+    val += (val << 3);
+    val ^= (val >> 11);
+    str->hash = val + (val << 15);
+    return str->hash;
+}
+
+static bool key_eq(js_string_t* a, js_string_t* b)
+{
+    return a == b || (a->length == b->length && memcmp(a->buff, b->buff, a->length) == 0);
+}
+
+static bool key_matches(void* table, uint32_t entry, void* key)
+{
+    return key_eq(((js_proptable_t*)table)->entries[entry].key, key);
+}
+
+js_proptable_t* js_proptable_new()
+{
+    // the arrays aren't allocated until something's inserted, as plenty of objects never get any properties
+    return js_alloc(sizeof(js_proptable_t));
+}
+
+/* squeezes deleted entries out and rebuilds the index with room for at least one more entry */
+static void rebuild(js_proptable_t* table)
+{
+    uint32_t index_size = table->mask + 1;
+    uint32_t i, j;
+    js_proptable_entry_t* entries;
+    if(table->index == NULL) {
+        index_size = JS_HASHINDEX_MIN_SIZE;
+    } else if(table->count >= JS_HASHINDEX_CAPACITY(index_size) / 2) {
+        // mostly live entries, so it's actually full rather than full of holes:
+        index_size *= 2;
+    }
+    table->capacity = JS_HASHINDEX_CAPACITY(index_size);
+    table->mask = index_size - 1;
+    if(table->count == table->used) {
+        table->entries = js_realloc(table->entries, sizeof(js_proptable_entry_t) * table->capacity);
+    } else {
+        // compact into a new array, leaving the old one as it was for any iterators still walking it:
+        entries = js_alloc(sizeof(js_proptable_entry_t) * table->capacity);
+        for(i = 0, j = 0; i < table->used; i++) {
+            if(table->entries[i].key) {
+                entries[j++] = table->entries[i];
+            }
+        }
+        table->entries = entries;
+        table->used = j;
+        table->compactions++;
+    }
+    table->index = js_hashindex_new(index_size);
+    for(i = 0; i < table->used; i++) {
+        js_hashindex_insert(table->index, table->mask, table->entries[i].hash, i);
+    }
+}
+
+static uint32_t find_slot(js_proptable_t* table, js_string_t* key, uint32_t hash)
+{
+    return js_hashindex_find(table->index, table->mask, hash, key_matches, table, key);
+}
+
+bool js_proptable_lookup(js_proptable_t* table, js_string_t* key, void** value)
+{
+    uint32_t slot = find_slot(table, key, js_string_hash(key));
+    if(slot == JS_HASHINDEX_EMPTY) {
+        return false;
+    }
+    if(value) {
+        *value = table->entries[table->index[slot].entry].value;
+    }
+    return true;
+}
+
+bool js_proptable_insert(js_proptable_t* table, js_string_t* key, void* value)
+{
+    uint32_t hash = js_string_hash(key);
+    uint32_t slot = find_slot(table, key, hash);
+    js_proptable_entry_t* entry;
+    if(slot != JS_HASHINDEX_EMPTY) {
+        entry = &table->entries[table->index[slot].entry];
+        if(table->prototype && entry->value != value) {
+            js_proptable_epoch++;
+        }
+        entry->value = value;
+        return true;
+    }
+    if(table->prototype) {
+        js_proptable_epoch++;
+    }
+    if(table->used == table->capacity) {
+        rebuild(table);
+    }
+    entry = &table->entries[table->used];
+    entry->key = key;
+    entry->value = value;
+    entry->hash = hash;
+    js_hashindex_insert(table->index, table->mask, hash, table->used++);
+    table->count++;
+    return false;
+}
+
+bool js_proptable_delete(js_proptable_t* table, js_string_t* key)
+{
+    uint32_t slot = find_slot(table, key, js_string_hash(key));
+    js_proptable_entry_t* entry;
+    if(slot == JS_HASHINDEX_EMPTY) {
+        return false;
+    }
+    if(table->prototype) {
+        js_proptable_epoch++;
+    }
+    entry = &table->entries[table->index[slot].entry];
+    entry->key = NULL;
+    entry->value = NULL;
+    table->count--;
+    js_hashindex_remove(table->index, table->mask, slot);
+    return true;
+}
+
+bool js_proptable_next(js_proptable_t* table, uint32_t* cursor, js_string_t** key, void** value)
+{
+    while(*cursor < table->used) {
+        js_proptable_entry_t* entry = &table->entries[(*cursor)++];
+        if(entry->key) {
+            *key = entry->key;
+            *value = entry->value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void js_proptable_iter_init(js_proptable_t* table, js_proptable_iter_t* iter)
+{
+    iter->table = table;
+    iter->entries = table->entries;
+    iter->used = table->used;
+    iter->position = 0;
+    iter->compactions = table->compactions;
+}
+
+bool js_proptable_iter_next(js_proptable_iter_t* iter, js_string_t** key, void** value)
+{
+    js_proptable_entry_t* entry;
+    bool stale = iter->compactions != iter->table->compactions;
+    if(!stale) {
+        // growing can still move the entries, just not reorder them:
+        iter->entries = iter->table->entries;
+        iter->used = iter->table->used;
+    }
+    while(iter->position < iter->used) {
+        entry = &iter->entries[iter->position++];
+        if(entry->key == NULL) {
+            continue;
+        }
+        if(!stale) {
+            *key = entry->key;
+            *value = entry->value;
+            return true;
+        }
+        // the table has been compacted since, so what's being walked is an old copy of it:
+        if(js_proptable_lookup(iter->table, entry->key, value)) {
+            *key = entry->key;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include "scope.h"
 #include "vm.h"
 #include "gc.h"
@@ -6,10 +7,13 @@
 
 js_scope_t* js_scope_make_global(js_vm_t* vm, VAL object)
 {
-    js_scope_t* scope = js_alloc(sizeof(js_scope_t));
+    js_scope_t* scope = js_alloc(sizeof(js_scope_t) + sizeof(js_scope_t*));
     scope->parent = NULL;
     scope->global = scope;
     scope->vm = vm;
+    scope->depth = 0;
+    scope->display = (js_scope_t**)(scope + 1);
+    scope->display[0] = scope;
     if(js_value_is_primitive(object)) {
         js_panic("primitive passed as global object");
     }
@@ -17,12 +21,23 @@ js_scope_t* js_scope_make_global(js_vm_t* vm, VAL object)
     return scope;
 }
 
-VAL js_scope_get_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes)
+/* the scope upper_scopes above this one, or NULL if that would be the global scope or
+   beyond, which doesn't have numbered variables */
+static js_scope_t* upper_scope(js_scope_t* scope, uint32_t upper_scopes)
 {
-    if(upper_scopes > 0) {
-        return scope->parent ? js_scope_get_var(scope->parent, index, upper_scopes - 1) : js_value_undefined();
+    if(upper_scopes == 0) {
+        return scope->parent ? scope : NULL;
+    }
+    if(upper_scopes >= scope->depth) {
+        return NULL;
     }
-    if(index >= scope->locals.count) {
+    return scope->parent->display[upper_scopes - 1];
+}
+
+VAL js_scope_get_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes)
+{
+    scope = upper_scope(scope, upper_scopes);
+    if(scope == NULL || index >= scope->locals.count) {
         return js_value_undefined();
     }
     return scope->locals.vars[index];
@@ -31,17 +46,16 @@ VAL js_scope_get_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes)
 void js_scope_set_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes, VAL value)
 {
     uint32_t old_size;
-    if(upper_scopes > 0) {
-        if(scope->parent) {
-            js_scope_set_var(scope->parent, index, upper_scopes - 1, value);
-        }
+    scope = upper_scope(scope, upper_scopes);
+    if(scope == NULL) {
         return;
     }
     old_size = scope->locals.count;
     if(old_size <= index) {
+        // scopes are made with room for all their variables, so this is only for hand made images:
         while(scope->locals.count <= index) {
-            scope->locals.count *= 2;
-        }    
+            scope->locals.count = scope->locals.count ? scope->locals.count * 2 : 4;
+        }
         scope->locals.vars = js_realloc(scope->locals.vars, scope->locals.count * sizeof(VAL));
         for(; old_size < scope->locals.count; old_size++) {
             scope->locals.vars[old_size] = js_value_undefined();
@@ -50,9 +64,19 @@ void js_scope_set_var(js_scope_t* scope, uint32_t index, uint32_t upper_scopes,
     scope->locals.vars[index] = value;
 }
 
-js_scope_t* js_scope_close(js_scope_t* scope, VAL callee)
+js_scope_t* js_scope_close(js_scope_t* scope, VAL callee, uint32_t var_count)
 {
-    return js_scope_close_placement(js_alloc(sizeof(js_scope_t)), scope, callee, 4, js_alloc(4 * sizeof(VAL)));
+    VAL* vars = var_count ? js_alloc(var_count * sizeof(VAL)) : NULL;
+    // the display goes in the same allocation, right after the scope:
+    js_scope_t* new_scope = js_alloc(sizeof(js_scope_t) + (scope->depth + 2) * sizeof(js_scope_t*));
+    if(scope->display == NULL) {
+        js_panic("js_scope_close: can't close over a scope made by js_scope_close_placement");
+    }
+    js_scope_close_placement(new_scope, scope, callee, var_count, vars);
+    new_scope->display = (js_scope_t**)(new_scope + 1);
+    new_scope->display[0] = new_scope;
+    memcpy(new_scope->display + 1, scope->display, (scope->depth + 1) * sizeof(js_scope_t*));
+    return new_scope;
 }
 
 js_scope_t* js_scope_close_placement(js_scope_t* new_scope, js_scope_t* scope, VAL callee, uint32_t var_count, VAL* vars)
@@ -61,6 +85,8 @@ js_scope_t* js_scope_close_placement(js_scope_t* new_scope, js_scope_t* scope, V
     new_scope->vm = scope->vm;
     new_scope->parent = scope;
     new_scope->global = scope->global;
+    new_scope->depth = scope->depth + 1;
+    new_scope->display = NULL;
     new_scope->locals.callee = callee;
     new_scope->locals.count = var_count;
     new_scope->locals.vars = vars;
@@ -6,6 +6,7 @@
 #include "gc.h"
 #include "value.h"
 #include "exception.h"
+#include "dtoa.h"
 
 js_string_t* js_string_concat(js_string_t* a, js_string_t* b)
 {
@@ -29,25 +30,226 @@ bool js_string_eq(js_string_t* a, js_string_t* b)
     return memcmp(a->buff, b->buff, a->length) == 0;
 }
 
-bool js_string_index_of(js_string_t* haystack, js_string_t* needle, uint32_t* index)
+/* substring search goes a word at a time, since the kernel never turns SSE on. the
+   haystack is only ever read up to its end, which needn't be word aligned, and
+   unaligned loads are fine on x86 */
+typedef uint32_t unaligned_word_t __attribute__((aligned(1), may_alias));
+
+/* needles this long or longer go through Two-Way, which is linear however the
+   needle and haystack are made up, where filtering on the first and last bytes can
+   degrade to checking the whole needle at most positions */
+#define TWO_WAY_MIN_NEEDLE 32
+
+/* a word with each of its bytes set to c */
+#define BYTES(c) ((uint32_t)(uint8_t)(c) * 0x01010101u)
+
+/* the top bit of each byte of x that's zero */
+static uint32_t zero_bytes(uint32_t x)
+{
+    return ~(((x & 0x7f7f7f7f) + 0x7f7f7f7f) | x | 0x7f7f7f7f);
+}
+
+static bool bytes_equal(char* a, char* b, uint32_t length)
+{
+    uint32_t i;
+    for(i = 0; i < length; i++) {
+        if(a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static char* find_byte(char* haystack, char* end, char c)
 {
-    uint32_t a, i;
-    for(a = 0; a < haystack->length; a++) {
-        for(i = 0; i < needle->length; i++) {
-            if(haystack->buff[a + i] != needle->buff[i]) {
-                goto next;
+    uint32_t pattern = BYTES(c);
+    for(; haystack + 8 <= end; haystack += 8) {
+        uint32_t low = *(unaligned_word_t*)haystack ^ pattern;
+        uint32_t high = *(unaligned_word_t*)(haystack + 4) ^ pattern;
+        // a cheap test that there's a zero byte in either word, which can be wrong
+        // about where but not about whether:
+        if(((low - 0x01010101u) & ~low & 0x80808080u) | ((high - 0x01010101u) & ~high & 0x80808080u)) {
+            break;
+        }
+    }
+    for(; haystack + 4 <= end; haystack += 4) {
+        uint32_t found = zero_bytes(*(unaligned_word_t*)haystack ^ pattern);
+        if(found) {
+            return haystack + __builtin_ctz(found) / 8;
+        }
+    }
+    for(; haystack < end; haystack++) {
+        if(*haystack == c) {
+            return haystack;
+        }
+    }
+    return NULL;
+}
+
+/* only positions where the needle's first and last bytes both match are checked,
+   and those are found four at a time */
+static char* find_short(char* haystack, char* end, char* needle, uint32_t length)
+{
+    uint32_t first = BYTES(needle[0]), last = BYTES(needle[length - 1]);
+    char* stop = end - length + 1;
+    for(; haystack + 4 <= stop; haystack += 4) {
+        uint32_t candidates = zero_bytes(*(unaligned_word_t*)haystack ^ first)
+            & zero_bytes(*(unaligned_word_t*)(haystack + length - 1) ^ last);
+        while(candidates) {
+            char* candidate = haystack + __builtin_ctz(candidates) / 8;
+            if(bytes_equal(candidate + 1, needle + 1, length - 2)) {
+                return candidate;
             }
+            candidates &= candidates - 1;
+        }
+    }
+    for(; haystack < stop; haystack++) {
+        if(haystack[0] == needle[0] && haystack[length - 1] == needle[length - 1]
+            && bytes_equal(haystack + 1, needle + 1, length - 2)) {
+            return haystack;
+        }
+    }
+    return NULL;
+}
+
+/* Crochemore & Perrin's Two-Way algorithm, as musl does it for memmem. the needle is
+   split at its critical factorization, the right half is matched first, and the
+   needle's period says how far to move on without rereading anything. a table of
+   where each byte last occurs in the needle lets the haystack be skipped through
+   quickly while its last byte doesn't match */
+static char* find_two_way(char* haystack, char* end, char* needle, uint32_t length)
+{
+    uint8_t* h = (uint8_t*)haystack;
+    uint8_t* n = (uint8_t*)needle;
+    uint32_t i, ip, jp, k, p, ms, p0, mem, mem0;
+    uint32_t shift[256];
+    bool present[256];
+    
+    memset(present, 0, sizeof(present));
+    for(i = 0; i < length; i++) {
+        present[n[i]] = true;
+        shift[n[i]] = i + 1;
+    }
+    
+    // the maximal suffix, by one ordering of the bytes and then the other:
+    ip = -1;
+    jp = 0;
+    k = p = 1;
+    while(jp + k < length) {
+        if(n[ip + k] == n[jp + k]) {
+            if(k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if(n[ip + k] > n[jp + k]) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
         }
-        // found the substring
-        *index = a;
+    }
+    ms = ip;
+    p0 = p;
+    ip = -1;
+    jp = 0;
+    k = p = 1;
+    while(jp + k < length) {
+        if(n[ip + k] == n[jp + k]) {
+            if(k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if(n[ip + k] < n[jp + k]) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    if(ip + 1 > ms + 1) {
+        ms = ip;
+    } else {
+        p = p0;
+    }
+    
+    // a needle that isn't periodic can move on past everything that was matched,
+    // and one that is has to remember how much of itself it already matched:
+    if(!bytes_equal(needle, needle + p, ms + 1)) {
+        mem0 = 0;
+        p = (ms > length - ms - 1 ? ms : length - ms - 1) + 1;
+    } else {
+        mem0 = length - p;
+    }
+    mem = 0;
+    
+    while((uint32_t)((uint8_t*)end - h) >= length) {
+        if(!present[h[length - 1]]) {
+            h += length;
+            mem = 0;
+            continue;
+        }
+        k = length - shift[h[length - 1]];
+        if(k) {
+            h += k < mem ? mem : k;
+            mem = 0;
+            continue;
+        }
+        for(k = ms + 1 > mem ? ms + 1 : mem; k < length && n[k] == h[k]; k++);
+        if(k < length) {
+            h += k - ms;
+            mem = 0;
+            continue;
+        }
+        for(k = ms + 1; k > mem && n[k - 1] == h[k - 1]; k--);
+        if(k <= mem) {
+            return (char*)h;
+        }
+        h += p;
+        mem = mem0;
+    }
+    return NULL;
+}
+
+bool js_string_index_of(js_string_t* haystack, js_string_t* needle, uint32_t* index)
+{
+    char* end = haystack->buff + haystack->length;
+    char* found;
+    if(needle->length > haystack->length) {
+        return false;
+    }
+    if(needle->length == 0) {
+        *index = 0;
         return true;
-    next: continue;
     }
-    return false;
+    if(needle->length == 1) {
+        found = find_byte(haystack->buff, end, needle->buff[0]);
+    } else if(needle->length < TWO_WAY_MIN_NEEDLE) {
+        found = find_short(haystack->buff, end, needle->buff, needle->length);
+    } else {
+        found = find_two_way(haystack->buff, end, needle->buff, needle->length);
+    }
+    if(found == NULL) {
+        return false;
+    }
+    *index = found - haystack->buff;
+    return true;
 }
 
 js_string_t* js_string_from_double(double number)
 {
+    char digits[JS_DTOA_MAX_DIGITS];
+    char buff[JS_DTOA_MAX_DIGITS + 16];
+    char* ptr = buff;
+    uint32_t count, i;
+    int32_t point;
     if(number != number) {
         return js_cstring("NaN");
     }
@@ -58,37 +260,114 @@ js_string_t* js_string_from_double(double number)
             return js_cstring("-Infinity");
         }
     }
-    double whole = floor(number);
-    double frac = fabs(number) - fabs(whole);
-    char buff[1024];
-    char* ptr = buff;
-    if(whole < 0) {
+    if(number == 0) {
+        // -0 prints as 0 too
+        return js_string_from_index(0);
+    }
+    if(number > 0 && number < 4294967295.0 && number == (uint32_t)number) {
+        return js_string_from_index((uint32_t)number);
+    }
+    if(number < 0) {
         *ptr++ = '-';
-        whole = -number;
+        number = -number;
     }
-    if(whole == 0) {
+    count = js_dtoa_shortest(number, digits, &point);
+    // laid out as in ECMA-262's Number::toString, where the value is
+    // 0.digits * 10^point:
+    if((int32_t)count <= point && point <= 21) {
+        memcpy(ptr, digits, count);
+        ptr += count;
+        for(i = count; (int32_t)i < point; i++) {
+            *ptr++ = '0';
+        }
+    } else if(0 < point && point <= 21) {
+        memcpy(ptr, digits, point);
+        ptr += point;
+        *ptr++ = '.';
+        memcpy(ptr, digits + point, count - point);
+        ptr += count - point;
+    } else if(-6 < point && point <= 0) {
         *ptr++ = '0';
+        *ptr++ = '.';
+        for(i = 0; (int32_t)i < -point; i++) {
+            *ptr++ = '0';
+        }
+        memcpy(ptr, digits, count);
+        ptr += count;
+    } else {
+        uint32_t exponent = point > 0 ? point - 1 : 1 - point;
+        *ptr++ = digits[0];
+        if(count > 1) {
+            *ptr++ = '.';
+            memcpy(ptr, digits + 1, count - 1);
+            ptr += count - 1;
+        }
+        *ptr++ = 'e';
+        *ptr++ = point > 0 ? '+' : '-';
+        if(exponent >= 100) {
+            *ptr++ = '0' + exponent / 100;
+        }
+        if(exponent >= 10) {
+            *ptr++ = '0' + exponent / 10 % 10;
+        }
+        *ptr++ = '0' + exponent % 10;
     }
-    char minibuff[1024];
-    memset(minibuff, 0, 1024);
-    uint32_t minibuff_i = 0;
-    while(whole > 0) {
-        minibuff[minibuff_i++] = '0' + (int)fmod(whole, 10.0);
-        whole = floor(whole / 10.0);
+    *ptr = 0;
+    return js_cstring(buff);
+}
+
+bool js_string_to_index(js_string_t* str, uint32_t* index)
+{
+    uint32_t i, value = 0;
+    // canonical array indices are 0 to 2^32 - 2 with no leading zeroes:
+    if(str->length == 0 || str->length > 10 || (str->buff[0] == '0' && str->length > 1)) {
+        return false;
     }
-    while(minibuff_i > 0) {
-        *ptr++ = minibuff[--minibuff_i];
+    for(i = 0; i < str->length; i++) {
+        if(str->buff[i] < '0' || str->buff[i] > '9') {
+            return false;
+        }
+        if(value > 429496729 || (value == 429496729 && str->buff[i] > '4')) {
+            // would be 2^32 - 1 or more
+            return false;
+        }
+        value = value * 10 + (str->buff[i] - '0');
     }
-    uint32_t frac_i;
-    if(frac > 0) {
-        *ptr++ = '.';
-        for(frac_i = 0; frac_i < 6; frac_i++) {
-            frac = fmod(frac * 10.0, 10.0);
-            *ptr++ = '0' + (int)floor(frac);
+    *index = value;
+    return true;
+}
+
+/* for-in loops and the like ask for the same few index strings over and over, so
+   those are made once and shared */
+#define SMALL_INDEX_STRINGS 1024
+static js_string_t* small_index_strings[SMALL_INDEX_STRINGS];
+static bool small_index_strings_registered;
+
+js_string_t* js_string_from_index(uint32_t index)
+{
+    char digits[10];
+    uint32_t i = sizeof(digits), n = index;
+    js_string_t* str;
+    if(index < SMALL_INDEX_STRINGS && small_index_strings[index]) {
+        return small_index_strings[index];
+    }
+    do {
+        digits[--i] = '0' + n % 10;
+        n /= 10;
+    } while(n);
+    str = js_alloc(sizeof(js_string_t));
+    str->length = sizeof(digits) - i;
+    str->buff = js_alloc_no_pointer(str->length + 1);
+    memcpy(str->buff, digits + i, str->length);
+    str->buff[str->length] = 0;
+    if(index < SMALL_INDEX_STRINGS) {
+        if(!small_index_strings_registered) {
+            small_index_strings_registered = true;
+            js_gc_register_global(small_index_strings, sizeof(small_index_strings));
         }
+        small_index_strings[index] = str;
     }
-    *ptr++ = 0;
-    return js_cstring(buff);
+    return str;
 }
 
 js_string_t* js_string_format(char* fmt, ...)
@@ -102,10 +381,140 @@ js_string_t* js_string_format(char* fmt, ...)
 }
 
 js_string_t* js_string_vformat(char* fmt, va_list args)
+{
+    char storage[128];
+    js_string_builder_t builder;
+    js_string_builder_init(&builder, storage, sizeof(storage));
+    js_string_builder_vformat(&builder, fmt, args);
+    return js_string_builder_finish(&builder);
+}
+
+void js_string_builder_init(js_string_builder_t* builder, char* storage, uint32_t size)
+{
+    builder->length = 0;
+    builder->capacity = size;
+    builder->buff = storage;
+    builder->on_heap = false;
+}
+
+static void builder_reserve(js_string_builder_t* builder, uint32_t extra)
+{
+    uint32_t capacity = builder->capacity ? builder->capacity : 16;
+    char* buff;
+    if(builder->length + extra <= builder->capacity) {
+        return;
+    }
+    while(capacity < builder->length + extra) {
+        capacity *= 2;
+    }
+    if(builder->on_heap) {
+        builder->buff = js_realloc(builder->buff, capacity);
+    } else {
+        buff = js_alloc_no_pointer(capacity);
+        memcpy(buff, builder->buff, builder->length);
+        builder->buff = buff;
+        builder->on_heap = true;
+    }
+    builder->capacity = capacity;
+}
+
+void js_string_builder_append(js_string_builder_t* builder, char* str, uint32_t length)
+{
+    builder_reserve(builder, length);
+    memcpy(builder->buff + builder->length, str, length);
+    builder->length += length;
+}
+
+void js_string_builder_append_uint32(js_string_builder_t* builder, uint32_t value, uint32_t base)
+{
+    char digits[32];
+    uint32_t i = sizeof(digits);
+    do {
+        digits[--i] = "0123456789abcdef"[value % base];
+        value /= base;
+    } while(value);
+    js_string_builder_append(builder, digits + i, sizeof(digits) - i);
+}
+
+void js_string_builder_append_int32(js_string_builder_t* builder, int32_t value)
+{
+    if(value < 0) {
+        js_string_builder_append(builder, "-", 1);
+        // negating as unsigned works for INT32_MIN too:
+        js_string_builder_append_uint32(builder, -(uint32_t)value, 10);
+    } else {
+        js_string_builder_append_uint32(builder, value, 10);
+    }
+}
+
+void js_string_builder_format(js_string_builder_t* builder, char* fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    js_string_builder_vformat(builder, fmt, va);
+    va_end(va);
+}
+
+void js_string_builder_vformat(js_string_builder_t* builder, char* fmt, va_list args)
+{
+    char* literal;
+    char* conversion;
+    while(*fmt) {
+        literal = fmt;
+        while(*fmt && *fmt != '%') {
+            fmt++;
+        }
+        js_string_builder_append(builder, literal, fmt - literal);
+        if(!*fmt) {
+            break;
+        }
+        conversion = fmt++;
+        // lengths don't matter when int and long are the same size:
+        while(*fmt == 'l') {
+            fmt++;
+        }
+        switch(*fmt) {
+            case 's': {
+                char* str = va_arg(args, char*);
+                js_string_builder_append(builder, str, strlen(str));
+                break;
+            }
+            case 'c': {
+                char c = (char)va_arg(args, int);
+                js_string_builder_append(builder, &c, 1);
+                break;
+            }
+            case 'd':
+            case 'i':
+                js_string_builder_append_int32(builder, va_arg(args, int32_t));
+                break;
+            case 'u':
+                js_string_builder_append_uint32(builder, va_arg(args, uint32_t), 10);
+                break;
+            case 'x':
+                js_string_builder_append_uint32(builder, va_arg(args, uint32_t), 16);
+                break;
+            case '%':
+                js_string_builder_append(builder, "%", 1);
+                break;
+            default:
+                // passing it through would leave its argument on the list for the next conversion to pick up:
+                js_panic("unsupported conversion in format string: %s", conversion);
+        }
+        fmt++;
+    }
+}
+
+js_string_t* js_string_builder_finish(js_string_builder_t* builder)
 {
     js_string_t* str = js_alloc(sizeof(js_string_t));
-    str->buff = js_alloc_no_pointer(1024);
-    str->length = vsnprintf(str->buff, 1023, fmt, args);
-    str->buff[1023] = 0;
+    str->length = builder->length;
+    if(builder->on_heap) {
+        str->buff = js_realloc(builder->buff, builder->length + 1);
+    } else {
+        str->buff = js_alloc_no_pointer(builder->length + 1);
+        memcpy(str->buff, builder->buff, builder->length);
+    }
+    str->buff[str->length] = 0;
     return str;
-}
\ No newline at end of file
+}
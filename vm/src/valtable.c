@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include "valtable.h"
+#include "proptable.h"
+#include "gc.h"
+
+#define CANONICAL_NAN 0x7ff8000000000000ull
+
+js_valtable_t* js_valtable_new()
+{
+    return js_alloc(sizeof(js_valtable_t));
+}
+
+/* all NaNs are the same key, and so are both zeroes */
+static VAL normalize(VAL key)
+{
+    double d;
+    if(js_value_get_type(key) == JS_T_NUMBER) {
+        d = js_value_get_double(key);
+        if(d != d) {
+            key.i = CANONICAL_NAN;
+        } else if(d == 0) {
+            key.d = 0;
+        }
+    }
+    return key;
+}
+
+static uint32_t hash_value(VAL key)
+{
+    uint32_t h;
+    if(js_value_get_type(key) == JS_T_STRING) {
+        return js_string_hash(&js_value_get_pointer(key)->string);
+    }
+    h = (uint32_t)key.i ^ ((uint32_t)(key.i >> 32) * 0x9e3779b1);
+    h *= 0x85ebca6b;
+    return h ^ (h >> 16);
+}
+
+static bool key_eq(VAL a, VAL b)
+{
+    js_string_t *x, *y;
+    if(a.i == b.i) {
+        return true;
+    }
+    if(js_value_get_type(a) != JS_T_STRING || js_value_get_type(b) != JS_T_STRING) {
+        return false;
+    }
+    x = &js_value_get_pointer(a)->string;
+    y = &js_value_get_pointer(b)->string;
+    return x->length == y->length && memcmp(x->buff, y->buff, x->length) == 0;
+}
+
+static bool key_matches(void* table, uint32_t entry, void* key)
+{
+    return key_eq(((js_valtable_t*)table)->entries[entry].key, *(VAL*)key);
+}
+
+/* rebuilds the index with room for at least one more entry, squeezing deleted
+   entries out unless someone is iterating over the table */
+static void rebuild(js_valtable_t* table)
+{
+    uint32_t index_size = table->mask + 1;
+    uint32_t i, j;
+    if(table->index == NULL) {
+        index_size = JS_HASHINDEX_MIN_SIZE;
+    } else if(table->iterating || table->count >= JS_HASHINDEX_CAPACITY(index_size) / 2) {
+        index_size *= 2;
+    }
+    if(!table->iterating) {
+        for(i = 0, j = 0; i < table->used; i++) {
+            if(table->entries[i].key.i != JS_VALUE_HOLE) {
+                table->entries[j++] = table->entries[i];
+            }
+        }
+        table->used = j;
+    }
+    table->capacity = JS_HASHINDEX_CAPACITY(index_size);
+    table->mask = index_size - 1;
+    table->entries = js_realloc(table->entries, sizeof(js_valtable_entry_t) * table->capacity);
+    table->index = js_hashindex_new(index_size);
+    for(i = 0; i < table->used; i++) {
+        if(table->entries[i].key.i != JS_VALUE_HOLE) {
+            js_hashindex_insert(table->index, table->mask, table->entries[i].hash, i);
+        }
+    }
+}
+
+static uint32_t find_slot(js_valtable_t* table, VAL key, uint32_t hash)
+{
+    return js_hashindex_find(table->index, table->mask, hash, key_matches, table, &key);
+}
+
+bool js_valtable_lookup(js_valtable_t* table, VAL key, VAL* value)
+{
+    uint32_t slot;
+    key = normalize(key);
+    slot = find_slot(table, key, hash_value(key));
+    if(slot == JS_HASHINDEX_EMPTY) {
+        return false;
+    }
+    if(value) {
+        *value = table->entries[table->index[slot].entry].value;
+    }
+    return true;
+}
+
+bool js_valtable_insert(js_valtable_t* table, VAL key, VAL value)
+{
+    uint32_t hash, slot;
+    js_valtable_entry_t* entry;
+    key = normalize(key);
+    hash = hash_value(key);
+    slot = find_slot(table, key, hash);
+    if(slot != JS_HASHINDEX_EMPTY) {
+        table->entries[table->index[slot].entry].value = value;
+        return true;
+    }
+    if(table->used == table->capacity) {
+        rebuild(table);
+    }
+    entry = &table->entries[table->used];
+    entry->key = key;
+    entry->value = value;
+    entry->hash = hash;
+    js_hashindex_insert(table->index, table->mask, hash, table->used++);
+    table->count++;
+    return false;
+}
+
+bool js_valtable_delete(js_valtable_t* table, VAL key)
+{
+    uint32_t slot;
+    js_valtable_entry_t* entry;
+    key = normalize(key);
+    slot = find_slot(table, key, hash_value(key));
+    if(slot == JS_HASHINDEX_EMPTY) {
+        return false;
+    }
+    entry = &table->entries[table->index[slot].entry];
+    entry->key.i = JS_VALUE_HOLE;
+    entry->value = js_value_undefined();
+    table->count--;
+    js_hashindex_remove(table->index, table->mask, slot);
+    return true;
+}
+
+void js_valtable_clear(js_valtable_t* table)
+{
+    uint32_t i;
+    if(table->iterating && table->used) {
+        // keep the entries where they are so iterators carry on from the right place:
+        for(i = 0; i < table->used; i++) {
+            table->entries[i].key.i = JS_VALUE_HOLE;
+            table->entries[i].value = js_value_undefined();
+        }
+        js_hashindex_clear(table->index, table->mask);
+        table->count = 0;
+        return;
+    }
+    table->count = 0;
+    table->used = 0;
+    table->capacity = 0;
+    table->mask = 0;
+    table->entries = NULL;
+    table->index = NULL;
+}
+
+bool js_valtable_next(js_valtable_t* table, uint32_t* cursor, VAL* key, VAL* value)
+{
+    while(*cursor < table->used) {
+        js_valtable_entry_t* entry = &table->entries[(*cursor)++];
+        if(entry->key.i != JS_VALUE_HOLE) {
+            *key = entry->key;
+            *value = entry->value;
+            return true;
+        }
+    }
+    return false;
+}
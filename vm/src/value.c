@@ -12,6 +12,8 @@
 #include "lib.h"
 #include "exception.h"
 
+#define MOVABLE_STRING_LENGTH 4096
+
 /*
  *
  * bit twiddling stuff
@@ -113,7 +115,7 @@ VAL js_value_make_object(VAL prototype, VAL class)
     obj->object.vtable = js_object_base_vtable();
     obj->object.prototype = prototype;
     obj->object.class = class;
-    obj->object.properties = js_st_table_new();
+    obj->object.properties = js_proptable_new();
     return js_value_make_pointer(obj);
 }
 
@@ -125,7 +127,7 @@ VAL js_value_make_native_function(js_vm_t* vm, void* state, js_string_t* name, j
     fn->base.object.vtable = js_object_base_vtable();
     fn->base.object.prototype = vm->lib.Function_prototype;
     fn->base.object.class = vm->lib.Function;
-    fn->base.object.properties = js_st_table_new();
+    fn->base.object.properties = js_proptable_new();
     fn->is_native = true;
     fn->vm = vm;
     fn->name = name;
@@ -145,7 +147,7 @@ VAL js_value_make_function(js_vm_t* vm, js_image_t* image, uint32_t section, js_
     fn->base.object.vtable = js_object_base_vtable();
     fn->base.object.prototype = vm->lib.Function_prototype;
     fn->base.object.class = vm->lib.Function;
-    fn->base.object.properties = js_st_table_new();
+    fn->base.object.properties = js_proptable_new();
     fn->vm = vm;
     fn->is_native = false;
     fn->name = NULL;
@@ -166,7 +168,12 @@ VAL js_value_make_string(char* buff, uint32_t len)
 {
     js_value_t* val = js_alloc(sizeof(js_value_t));
     val->type = JS_T_STRING;
-    val->string.buff = js_alloc_no_pointer(len + 1);
+    if(len >= MOVABLE_STRING_LENGTH) {
+        // big strings (usually file contents) go in the movable space so they can be compacted:
+        val->string.buff = js_alloc_movable(len + 1, &val->string.buff);
+    } else {
+        val->string.buff = js_alloc_no_pointer(len + 1);
+    }
     memcpy(val->string.buff, buff, len);
     val->string.buff[len] = 0; /* null terminate to ensure things don't break with old c stuff */
     val->string.length = len;
@@ -443,6 +450,35 @@ void js_object_put(VAL obj, js_string_t* prop, VAL value)
     val->object.vtable->put(val, prop, value);
 }
 
+VAL js_object_get_index(VAL obj, uint32_t index)
+{
+    js_value_t* val;
+    if(js_value_is_primitive(obj)) {
+        // @TODO throw
+        js_panic("precondition failed, expected object but received primitive");
+    }
+    val = js_value_get_pointer(obj);
+    if(val->object.vtable->get_index) {
+        return val->object.vtable->get_index(val, index);
+    }
+    return val->object.vtable->get(val, js_string_from_index(index));
+}
+
+void js_object_put_index(VAL obj, uint32_t index, VAL value)
+{
+    js_value_t* val;
+    if(js_value_is_primitive(obj)) {
+        // @TODO throw
+        js_panic("precondition failed, expected object but received primitive");
+    }
+    val = js_value_get_pointer(obj);
+    if(val->object.vtable->put_index) {
+        val->object.vtable->put_index(val, index, value);
+    } else {
+        val->object.vtable->put(val, js_string_from_index(index), value);
+    }
+}
+
 bool js_object_has_property(VAL obj, js_string_t* prop)
 {
     js_value_t* val;
@@ -508,6 +544,51 @@ js_string_t** js_object_keys(VAL obj, uint32_t* count)
     return val->object.vtable->keys(val, count);
 }
 
+void js_object_enumerate(VAL obj, js_enumerator_t* enumerator)
+{
+    js_value_t* val;
+    if(js_value_is_primitive(obj)) {
+        // @TODO throw
+        js_panic("precondition failed, expected object but received primitive");
+    }
+    val = js_value_get_pointer(obj);
+    enumerator->object = val;
+    enumerator->indices_done = val->object.vtable->next_index == NULL;
+    enumerator->index = 0;
+    enumerator->index_cursor.indices = NULL;
+    enumerator->index_cursor.count = 0;
+    enumerator->index_cursor.position = 0;
+    js_proptable_iter_init(val->object.properties, &enumerator->names);
+}
+
+js_string_t* js_enumerator_next(js_enumerator_t* enumerator)
+{
+    js_value_t* obj = enumerator->object;
+    js_string_t* key;
+    js_property_descriptor_t* descr;
+    uint32_t index;
+    if(!enumerator->indices_done) {
+        if(obj->object.vtable->next_index(obj, &enumerator->index, &enumerator->index_cursor)) {
+            key = js_string_from_index(enumerator->index);
+            // 2^32 - 2 is the highest index there is:
+            if(enumerator->index == 0xfffffffe) {
+                enumerator->indices_done = true;
+            } else {
+                enumerator->index++;
+            }
+            return key;
+        }
+        enumerator->indices_done = true;
+    }
+    while(js_proptable_iter_next(&enumerator->names, &key, (void**)&descr)) {
+        // index keys that ended up in the property table have had their turn already:
+        if(descr->enumerable && !(obj->object.properties->indexed && js_string_to_index(key, &index))) {
+            return key;
+        }
+    }
+    return NULL;
+}
+
 VAL js_call(VAL fn, VAL this, uint32_t argc, VAL* argv)
 {
     js_function_t* function;
@@ -524,10 +605,10 @@ VAL js_call(VAL fn, VAL this, uint32_t argc, VAL* argv)
     } else {
         js_section_t* section = &function->js.image->sections[function->js.section];
         if(section->flags & JS_FLAG_HAS_INNER_FUNCS) {
-            return js_vm_exec(function->vm, function->js.image, function->js.section, js_scope_close(function->js.outer_scope, fn), this, argc, argv);
+            return js_vm_exec(function->vm, function->js.image, function->js.section, js_scope_close(function->js.outer_scope, fn, section->var_count), this, argc, argv);
         } else {
             js_scope_t scope;
-            VAL locals[section->var_count];
+            VAL locals[section->var_count ? section->var_count : 1];
             js_scope_close_placement(&scope, function->js.outer_scope, fn, section->var_count, locals);
             return js_vm_exec(function->vm, function->js.image, function->js.section, &scope, this, argc, argv);
         }
@@ -552,10 +633,10 @@ VAL js_construct(VAL fn, uint32_t argc, VAL* argv)
     } else {
         js_section_t* section = &function->js.image->sections[function->js.section];
         if(section->flags & JS_FLAG_HAS_INNER_FUNCS) {
-            retn = js_vm_exec(function->vm, function->js.image, function->js.section, js_scope_close(function->js.outer_scope, fn), this, argc, argv);
+            retn = js_vm_exec(function->vm, function->js.image, function->js.section, js_scope_close(function->js.outer_scope, fn, section->var_count), this, argc, argv);
         } else {
             js_scope_t scope;
-            VAL locals[section->var_count];
+            VAL locals[section->var_count ? section->var_count : 1];
             js_scope_close_placement(&scope, function->js.outer_scope, fn, section->var_count, locals);
             retn = js_vm_exec(function->vm, function->js.image, function->js.section, &scope, this, argc, argv);
         }
@@ -567,56 +648,117 @@ VAL js_construct(VAL fn, uint32_t argc, VAL* argv)
     }
 }
 
+VAL js_arg(uint32_t argc, VAL* argv, uint32_t index)
+{
+    return index < argc ? argv[index] : js_value_undefined();
+}
+
+static VAL arg_of_type(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index, js_type_t type, char* type_name)
+{
+    VAL val = js_arg(argc, argv, index);
+    if(js_value_get_type(val) != type) {
+        js_throw_error(vm->lib.TypeError, "Expected %s in argument #%d", type_name, index + 1);
+    }
+    return val;
+}
+
+VAL js_arg_number(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index)
+{
+    return arg_of_type(vm, argc, argv, index, JS_T_NUMBER, "number");
+}
+
+VAL js_arg_string(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index)
+{
+    return arg_of_type(vm, argc, argv, index, JS_T_STRING, "string");
+}
+
+VAL js_arg_boolean(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index)
+{
+    return arg_of_type(vm, argc, argv, index, JS_T_BOOLEAN, "boolean");
+}
+
+uint32_t js_arg_uint32(struct js_vm* vm, uint32_t argc, VAL* argv, uint32_t index)
+{
+    return (uint32_t)js_value_get_double(js_arg_number(vm, argc, argv, index));
+}
+
 void js_scan_args(struct js_vm* vm, uint32_t argc, VAL* argv, char* fmt, ...)
 {
-    uint32_t i = 0, fmtlen = strlen(fmt);
+    uint32_t i;
     va_list va;
     va_start(va, fmt);
-    VAL* resized_argv = js_alloc(sizeof(VAL) * fmtlen);
-    memcpy(resized_argv, argv, sizeof(VAL) * (fmtlen < argc ? fmtlen : argc));
-    if(fmtlen > argc) {
-        uint32_t j;
-        for(j = argc; j < fmtlen; j++) {
-            resized_argv[j] = js_value_undefined();
-        }
-    }
-    for(i = 0; i < fmtlen; i++) {
+    for(i = 0; fmt[i]; i++) {
         VAL* v = va_arg(va, VAL*);
         switch(fmt[i]) {
             case 'N':
-                if(js_value_get_type(resized_argv[i]) != JS_T_NUMBER) {
-                    js_throw_error(vm->lib.TypeError, "Expected number in argument #%d", i + 1);
-                }
-                *v = resized_argv[i];
+                *v = js_arg_number(vm, argc, argv, i);
                 break;
             case 'n':
-                *v = js_to_number(resized_argv[i]);
+                *v = js_to_number(js_arg(argc, argv, i));
                 break;
             case 'S':
-                if(js_value_get_type(resized_argv[i]) != JS_T_STRING) {
-                    js_throw_error(vm->lib.TypeError, "Expected string in argument #%d", i + 1);
-                }
-                *v = resized_argv[i];
+                *v = js_arg_string(vm, argc, argv, i);
                 break;
             case 's':
-                *v = js_to_string(resized_argv[i]);
+                *v = js_to_string(js_arg(argc, argv, i));
                 break;
             case 'B':
-                if(js_value_get_type(resized_argv[i]) != JS_T_BOOLEAN) {
-                    js_throw_error(vm->lib.TypeError, "Expected boolean in argument #%d", i + 1);
-                }
-                *v = resized_argv[i];
+                *v = js_arg_boolean(vm, argc, argv, i);
                 break;
             case 'b':
-                *v = js_to_boolean(resized_argv[i]);
+                *v = js_to_boolean(js_arg(argc, argv, i));
                 break;
             case 'I':
-                if(js_value_get_type(resized_argv[i]) != JS_T_NUMBER) {
-                    js_throw_error(vm->lib.TypeError, "Expected number in argument #%d", i + 1);
-                }
-                uint32_t* vi = (uint32_t*)v;
-                *vi = (uint32_t)js_value_get_double(resized_argv[i]);
+                *(uint32_t*)v = js_arg_uint32(vm, argc, argv, i);
                 break;
         }
     }
+    va_end(va);
+}
+
+static char* census_names[] = {
+    "null", "undefined", "boolean", "number", "object", "string", "function",
+    "array", "string object", "number object", "boolean object", "other",
+};
+
+static uint32_t classify_allocation(void* ptr, size_t size)
+{
+    js_value_t* val = ptr;
+    // there's no type information in the heap, so anything that looks like a value counts as one:
+    if(size >= sizeof(js_value_t)) {
+        if(val->type == JS_T_STRING) {
+            if(size == sizeof(js_value_t) && js_gc_is_allocation(val->string.buff)) {
+                return JS_T_STRING;
+            }
+        } else if(val->type >= JS_T_OBJECT && val->type <= JS_T_BOOLEAN_OBJECT) {
+            if(val->object.vtable && js_gc_is_allocation(val->object.properties)) {
+                return val->type;
+            }
+        }
+    }
+    return JS_CENSUS_OTHER;
+}
+
+static void census_allocation(void* ptr, size_t size, void* state)
+{
+    js_census_entry_t* census = state;
+    uint32_t type = classify_allocation(ptr, size);
+    census[type].count++;
+    census[type].bytes += size;
+}
+
+void js_value_census(js_census_entry_t* census)
+{
+    uint32_t i;
+    for(i = 0; i <= JS_CENSUS_OTHER; i++) {
+        census[i].name = census_names[i];
+        census[i].count = 0;
+        census[i].bytes = 0;
+    }
+    js_gc_walk(census_allocation, census);
+}
+
+void js_value_heap_snapshot(js_gc_snapshot_writer_t write, void* state)
+{
+    js_gc_snapshot(classify_allocation, census_names, JS_CENSUS_OTHER + 1, write, state);
 }
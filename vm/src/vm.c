@@ -81,6 +81,10 @@ static js_instruction_t insns[] = {
     { "jend",       OPERAND_UINT32 },
     { "enumpop",    OPERAND_NONE },
     { "eq",         OPERAND_NONE },
+    { "pushlocal",  OPERAND_UINT32 },
+    { "setlocal",   OPERAND_UINT32 },
+    { "arglen",     OPERAND_NONE },
+    { "argindex",   OPERAND_NONE },
 };
 
 js_instruction_t* js_instruction(uint32_t opcode)
@@ -98,13 +102,32 @@ void js_vm_set_stack_limit(void* stack_limit_)
     stack_limit = stack_limit_;
 }
 
+static uint32_t global_instruction_counter = 0;
+
+static void vm_region_over_limit(js_gc_region_t* region)
+{
+    // allocations can happen anywhere, so rather than throwing from inside js_alloc
+    // the limit is checked next time round the interpreter loop:
+    global_instruction_counter = VM_CYCLES_PER_COLLECTION;
+}
+
+void js_vm_get_stats(js_vm_stats_t* stats)
+{
+    js_object_lookup_cache_stats(&stats->lookup_cache_hits, &stats->lookup_cache_misses);
+}
+
 js_vm_t* js_vm_new()
 {
+    js_gc_region_t* region = js_gc_region_new();
+    js_gc_region_t* previous_region = js_gc_set_region(region);
     js_vm_t* vm = js_alloc(sizeof(js_vm_t));
+    vm->region = region;
+    js_gc_set_region_limit_handler(vm_region_over_limit);
     // this proto/constructor is fixed up later by js_lib_initialize
     vm->global_scope = js_scope_make_global(vm, js_value_make_object(js_value_undefined(), js_value_undefined()));
     js_object_put(vm->global_scope->global_object, js_cstring("global"), vm->global_scope->global_object);
     js_lib_initialize(vm);
+    js_gc_set_region(previous_region);
     return vm;
 }
 
@@ -126,6 +149,54 @@ static int comparison_oper(VAL left, VAL right)
     }
 }
 
+/* numbers that are array indices can skip being converted to strings for index and setindex */
+static bool number_to_index(VAL val, uint32_t* index)
+{
+    double d;
+    if(js_value_get_type(val) != JS_T_NUMBER) {
+        return false;
+    }
+    d = js_value_get_double(val);
+    if(!(d >= 0 && d < 4294967295.0)) {
+        return false;
+    }
+    *index = (uint32_t)d;
+    return *index == d;
+}
+
+static VAL index_get(js_vm_t* vm, VAL object, VAL index)
+{
+    uint32_t i;
+    bool is_index = number_to_index(index, &i);
+    if(!is_index) {
+        index = js_to_string(index);
+    }
+    if(js_value_is_primitive(object)) {
+        object = js_to_object(vm, object);
+    }
+    if(is_index) {
+        return js_object_get_index(object, i);
+    }
+    return js_object_get(object, &js_value_get_pointer(index)->string);
+}
+
+static void index_put(js_vm_t* vm, VAL object, VAL index, VAL value)
+{
+    uint32_t i;
+    bool is_index = number_to_index(index, &i);
+    if(!is_index) {
+        index = js_to_string(index);
+    }
+    if(js_value_is_primitive(object)) {
+        object = js_to_object(vm, object);
+    }
+    if(is_index) {
+        js_object_put_index(object, i, value);
+    } else {
+        js_object_put(object, js_to_js_string_t(index), value);
+    }
+}
+
 /* @TODO: bounds checking here */
 #define NEXT_UINT32() (L->INSNS[L->IP++])
 #define NEXT_DOUBLE() (L->IP += 2, *(double*)&L->INSNS[L->IP - 2])
@@ -146,18 +217,9 @@ static int comparison_oper(VAL left, VAL right)
 #define POP()   (L->STACK[--L->SP/* < 0 ? popped_under_zero_hack() : L->SP*/])
 #define PEEK()  (L->STACK[L->SP - 1])
 
-static uint32_t global_instruction_counter = 0;
-
-struct exception_frame {
-    uint32_t catch;
-    uint32_t finally;
-    struct exception_frame* prev;
-};
-
 struct enum_frame {
-    js_string_t** keys;
-    uint32_t count;
-    uint32_t index;
+    js_enumerator_t enumerator;
+    js_string_t* key; // found by jend, for enumnext to push
     struct enum_frame* prev;
 };
 
@@ -166,6 +228,7 @@ struct vm_locals {
     js_image_t* image;
     uint32_t section;
     js_scope_t* scope;
+    VAL* locals;
     VAL this;
     uint32_t argc;
     VAL* argv;
@@ -185,26 +248,61 @@ struct vm_locals {
     VAL return_val;
     VAL return_after_finally_val;
     VAL exception;
-    struct exception_frame* exception_stack;
     js_exception_handler_t handler;
+    js_gc_region_t* previous_region;
     
     struct enum_frame* enum_stack;
 };
 
 static VAL vm_exec(struct vm_locals* L);
 
+static VAL make_arguments(struct vm_locals* L)
+{
+    VAL arguments = js_make_array(L->vm, L->argc, L->argv);
+    js_object_put(arguments, js_cstring("callee"), L->scope->locals.callee);
+    return arguments;
+}
+
+/* arguments[index] in functions that never need a real arguments object */
+static VAL argument_get(struct vm_locals* L, VAL index)
+{
+    uint32_t i;
+    if(number_to_index(index, &i)) {
+        return i < L->argc ? L->argv[i] : js_value_undefined();
+    }
+    // anything else could be a property like callee or length:
+    return index_get(L->vm, make_arguments(L), index);
+}
+
+/* for the instructions that take a JS_VAR_LOCAL tagged variable */
+static void set_var_ref(struct vm_locals* L, uint32_t var, VAL value)
+{
+    if(var & JS_VAR_LOCAL) {
+        L->locals[var & ~JS_VAR_LOCAL] = value;
+    } else {
+        js_scope_set_var(L->scope, var, 0, value);
+    }
+}
+
 int kprintf();
 
 VAL js_vm_exec(js_vm_t* vm, js_image_t* image, uint32_t section, js_scope_t* scope, VAL this, uint32_t argc, VAL* argv)
 {
     VAL fast_stack[32];
+    uint32_t i, local_count = image->sections[section].local_count;
+    VAL locals[local_count ? local_count : 1];
     
     struct vm_locals L;
     
+    for(i = 0; i < local_count; i++) {
+        locals[i] = js_value_undefined();
+    }
+    
     L.vm = vm;
     L.image = image;
     L.section = section;
     L.scope = scope;
+    L.locals = locals;
     L.this = this;
     L.argc = argc;
     L.argv = argv;
@@ -219,7 +317,6 @@ VAL js_vm_exec(js_vm_t* vm, js_image_t* image, uint32_t section, js_scope_t* sco
     L.temp_slot = js_value_undefined();
     L.current_line = 1;
     
-    L.exception_stack = NULL;
     L.exception_thrown = false;
     L.return_after_finally = false;
     L.will_return = false;
@@ -235,11 +332,28 @@ VAL js_vm_exec(js_vm_t* vm, js_image_t* image, uint32_t section, js_scope_t* sco
     
     L.handler.previous = js_current_exception_handler();
     js_set_exception_handler(&L.handler);
+    // anything allocated while running this vm's code is charged to it:
+    L.previous_region = js_gc_set_region(vm->region);
     VAL retn = vm_exec(&L);
+    js_gc_set_region(L.previous_region);
     js_set_exception_handler(L.handler.previous);
     return retn;
 }
 
+/* the innermost try or catch block around the instruction just run, if any */
+static js_exception_range_t* exception_range(struct vm_locals* L)
+{
+    js_section_t* section = &L->image->sections[L->section];
+    uint32_t i;
+    for(i = 0; i < section->exception_range_count; i++) {
+        js_exception_range_t* range = &section->exception_ranges[i];
+        if(L->IP > range->start && L->IP <= range->end) {
+            return range;
+        }
+    }
+    return NULL;
+}
+
 static VAL vm_exec(struct vm_locals* L)
 {
     uint32_t opcode;
@@ -249,17 +363,16 @@ static VAL vm_exec(struct vm_locals* L)
         L->exception_thrown = true;
         L->exception = L->handler.exception;
         if(js_value_is_object(L->handler.exception)) {
-            js_string_t* trace = js_value_get_pointer(L->handler.exception)->object.stack_trace;
-            trace = js_string_concat(trace, js_string_format("\n    at %s:%d", L->image->strings[L->image->name]->buff, L->current_line));
-            js_value_get_pointer(L->handler.exception)->object.stack_trace = trace;
+            js_stack_trace_push(js_value_get_pointer(L->handler.exception)->object.stack_trace, L->image, L->section, L->current_line);
         }
-        if(L->exception_stack) {
-            if(L->exception_stack->catch) {
-                L->IP = L->exception_stack->catch;
-            } else {
-                L->IP = L->exception_stack->finally;
-            }
+        js_exception_range_t* range = exception_range(L);
+        if(range) {
+            // the exception replaces any return that was waiting on a finally block:
+            L->return_after_finally = false;
+            L->return_after_finally_val = js_value_undefined();
+            L->IP = range->handler;
         } else {
+            js_gc_set_region(L->previous_region);
             js_set_exception_handler(L->handler.previous);
             js_throw(L->handler.exception);
         }
@@ -269,6 +382,13 @@ static VAL vm_exec(struct vm_locals* L)
         if(++global_instruction_counter >= VM_CYCLES_PER_COLLECTION) {
             global_instruction_counter = 0;
             js_gc_run();
+            if(js_gc_region_over_limit(L->vm->region)) {
+                // only give up once the region's garbage has actually been swept:
+                js_gc_finish_sweep();
+                if(js_gc_region_over_limit(L->vm->region)) {
+                    js_throw_error(L->vm->lib.RangeError, "VM memory limit of %d bytes exceeded", (int)js_gc_region_limit(L->vm->region));
+                }
+            }
         }
         if(L->will_return) {
             return L->return_val;
@@ -281,10 +401,11 @@ static VAL vm_exec(struct vm_locals* L)
             }
         
             case JS_OP_RET: {
-                if(L->exception_stack) {
+                js_exception_range_t* range = exception_range(L);
+                if(range) {
                     L->return_after_finally_val = POP();
                     L->return_after_finally = true;
-                    L->IP = L->exception_stack->finally;
+                    L->IP = range->finally;
                 } else {
                     return POP();
                 }
@@ -355,6 +476,18 @@ static VAL vm_exec(struct vm_locals* L)
                 PUSH(js_scope_get_var(L->scope, idx, sc));
                 break;
             }
+            
+            case JS_OP_SETLOCAL: {
+                uint32_t idx = NEXT_UINT32();
+                L->locals[idx] = PEEK();
+                break;
+            }
+            
+            case JS_OP_PUSHLOCAL: {
+                uint32_t idx = NEXT_UINT32();
+                PUSH(L->locals[idx]);
+                break;
+            }
         
             case JS_OP_TRUE: {
                 PUSH(js_value_true());
@@ -444,7 +577,7 @@ static VAL vm_exec(struct vm_locals* L)
             case JS_OP_SETCALLEE: {
                 uint32_t idx = NEXT_UINT32();
                 if(L->scope->parent) { /* not global scope... */
-                    js_scope_set_var(L->scope, idx, 0, L->scope->locals.callee);
+                    set_var_ref(L, idx, L->scope->locals.callee);
                 }
                 break;
             }
@@ -454,9 +587,9 @@ static VAL vm_exec(struct vm_locals* L)
                 uint32_t arg = NEXT_UINT32();
                 if(L->scope->parent) { /* not global scope... */
                     if(arg >= L->argc) {
-                        js_scope_set_var(L->scope, var, 0, js_value_undefined());
+                        set_var_ref(L, var, js_value_undefined());
                     } else {
-                        js_scope_set_var(L->scope, var, 0, L->argv[arg]);
+                        set_var_ref(L, var, L->argv[arg]);
                     }
                 }
                 break;
@@ -568,23 +701,17 @@ static VAL vm_exec(struct vm_locals* L)
             }
         
             case JS_OP_INDEX: {
-                VAL index = js_to_string(POP());
+                VAL index = POP();
                 VAL object = POP();
-                if(js_value_is_primitive(object)) {
-                    object = js_to_object(L->vm, object);
-                }
-                PUSH(js_object_get(object, &js_value_get_pointer(index)->string));
+                PUSH(index_get(L->vm, object, index));
                 break;
             }
         
             case JS_OP_SETINDEX: {
                 VAL val = POP();
-                VAL idx = js_to_string(POP());
+                VAL idx = POP();
                 VAL obj = POP();
-                if(js_value_is_primitive(obj)) {
-                    obj = js_to_object(L->vm, obj);
-                }
-                js_object_put(obj, js_to_js_string_t(idx), val);
+                index_put(L->vm, obj, idx, val);
                 PUSH(val);
                 break;
             }
@@ -701,45 +828,20 @@ static VAL vm_exec(struct vm_locals* L)
                 break;
             }
             
-            case JS_OP_TRY: {
-                uint32_t catch = NEXT_UINT32();
-                uint32_t finally = NEXT_UINT32();
-                struct exception_frame* frame = js_alloc(sizeof(struct exception_frame));
-                frame->catch = catch;
-                frame->finally = finally;
-                frame->prev = L->exception_stack;
-                L->exception_stack = frame;
-                break;
-            }
-            
-            case JS_OP_POPTRY: {
-                struct exception_frame* frame = L->exception_stack;
-                L->IP = frame->finally;
-                L->exception_stack = frame->prev;
-                break;
-            }
-            
             case JS_OP_CATCH: {
-                L->exception_stack->catch = 0;
-                js_scope_set_var(L->scope, NEXT_UINT32(), 0, L->exception);
+                set_var_ref(L, NEXT_UINT32(), L->exception);
                 L->exception = js_value_undefined();
                 L->exception_thrown = false;
                 break;
             }
             
             case JS_OP_CATCHG: {
-                L->exception_stack->catch = 0;
                 js_scope_set_global_var(L->scope, NEXT_STRING(), L->exception);
                 L->exception = js_value_undefined();
                 L->exception_thrown = false;
                 break;
             }
             
-            case JS_OP_POPCATCH: {
-                L->IP = L->exception_stack->finally;
-                break;
-            }
-            
             case JS_OP_FINALLY: {
                 break;
             }
@@ -749,6 +851,12 @@ static VAL vm_exec(struct vm_locals* L)
                     js_throw(L->exception);
                 }
                 if(L->return_after_finally) {
+                    // an enclosing try's finally has to run before the return too:
+                    js_exception_range_t* range = exception_range(L);
+                    if(range) {
+                        L->IP = range->finally;
+                        break;
+                    }
                     L->return_after_finally = false;
                     L->will_return = true;
                     L->return_val = L->return_after_finally_val;
@@ -785,9 +893,18 @@ static VAL vm_exec(struct vm_locals* L)
             
             case JS_OP_ARGUMENTS: {
                 uint32_t idx = NEXT_UINT32();
-                VAL arguments = js_make_array(L->vm, L->argc, L->argv);
-                js_object_put(arguments, js_cstring("callee"), L->scope->locals.callee);
-                js_scope_set_var(L->scope, idx, 0, arguments);
+                set_var_ref(L, idx, make_arguments(L));
+                break;
+            }
+            
+            case JS_OP_ARGLEN: {
+                PUSH(js_value_make_double(L->argc));
+                break;
+            }
+            
+            case JS_OP_ARGINDEX: {
+                VAL index = POP();
+                PUSH(argument_get(L, index));
                 break;
             }
             
@@ -810,20 +927,20 @@ static VAL vm_exec(struct vm_locals* L)
             case JS_OP_ENUM: {
                 struct enum_frame* frame = js_alloc(sizeof(struct enum_frame));
                 frame->prev = L->enum_stack;
-                frame->index = 0;
-                frame->keys = js_object_keys(js_to_object(L->vm, POP()), &frame->count);
+                js_object_enumerate(js_to_object(L->vm, POP()), &frame->enumerator);
                 L->enum_stack = frame;
                 break;
             }
             
             case JS_OP_ENUMNEXT: {
-                PUSH(js_value_wrap_string(L->enum_stack->keys[L->enum_stack->index++]));
+                PUSH(js_value_wrap_string(L->enum_stack->key));
                 break;
             }
             
             case JS_OP_JEND: {
                 uint32_t ip = NEXT_UINT32();
-                if(L->enum_stack->index == L->enum_stack->count) {
+                L->enum_stack->key = js_enumerator_next(&L->enum_stack->enumerator);
+                if(L->enum_stack->key == NULL) {
                     L->IP = ip;
                 }
                 break;
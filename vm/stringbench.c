@@ -0,0 +1,236 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "gc.h"
+#include "vm.h"
+#include "lib.h"
+#include "bench.h"
+
+/* checks substring search and split against straightforward versions and compares
+   their speed with the byte by byte search they replaced */
+
+#define RANDOM_SEARCHES 300000
+#define TEXT_LENGTH (1024 * 1024)
+
+/* gc roots */
+static js_vm_t* vm;
+static js_value_t* split_function;
+static js_string_t* split_strings[2];
+
+static bool old_index_of(js_string_t* haystack, js_string_t* needle, uint32_t* index)
+{
+    uint32_t a, i;
+    for(a = 0; a < haystack->length; a++) {
+        for(i = 0; i < needle->length; i++) {
+            if(haystack->buff[a + i] != needle->buff[i]) {
+                goto next;
+            }
+        }
+        // found the substring
+        *index = a;
+        return true;
+    next: continue;
+    }
+    return false;
+}
+
+/* the old split, on top of the old search. it makes a string object to split like
+   the real one is called with, so the two only differ in how they search */
+static VAL old_split(js_string_t* str, js_string_t* delimiter)
+{
+    js_make_string_object(vm, str);
+    js_value_wrap_string(delimiter);
+    uint32_t capacity = 4;
+    uint32_t count = 0;
+    VAL* items = js_alloc(sizeof(VAL) * 4);
+    js_string_t remaining = *str;
+    uint32_t index;
+    while(old_index_of(&remaining, delimiter, &index)) {
+        if(count + 1 == capacity) {
+            capacity *= 2;
+            items = js_realloc(items, sizeof(VAL) * capacity);
+        }
+        items[count++] = js_value_make_string(remaining.buff, index);
+        index += delimiter->length;
+        remaining.buff += index;
+        remaining.length -= index;
+    }
+    items[count++] = js_value_make_string(remaining.buff, remaining.length);
+    return js_make_array(vm, count, items);
+}
+
+static VAL new_split(js_string_t* str, js_string_t* delimiter)
+{
+    VAL argument = js_value_wrap_string(delimiter);
+    return js_call(js_value_make_pointer(split_function), js_make_string_object(vm, str), 1, &argument);
+}
+
+/* where needle really is, checked within haystack's bounds */
+static int32_t reference_index_of(char* haystack, uint32_t haystack_length, char* needle, uint32_t needle_length)
+{
+    uint32_t a;
+    if(needle_length > haystack_length) {
+        return -1;
+    }
+    for(a = 0; a + needle_length <= haystack_length; a++) {
+        if(memcmp(haystack + a, needle, needle_length) == 0) {
+            return a;
+        }
+    }
+    return -1;
+}
+
+static uint64_t random_state = 88172645463325252ull;
+
+static uint32_t random_below(uint32_t n)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return (uint32_t)(random_state >> 32) % n;
+}
+
+/* one failure is enough to tell something's off, so only the first few are shown */
+static uint32_t failures;
+
+/* haystacks and needles from small alphabets, so there are plenty of near misses
+   and periodic needles. the haystack is copied to the end of a buffer that's
+   followed by a copy of the needle, which an overread would find */
+static void accuracy()
+{
+    static char buff[512];
+    char needle_buff[128];
+    uint32_t i, j;
+    clock_t start = clock();
+    failures = 0;
+    for(i = 0; i < RANDOM_SEARCHES; i++) {
+        uint32_t alphabet = random_below(4) + 1;
+        uint32_t haystack_length = random_below(200);
+        uint32_t needle_length = random_below(i % 2 ? 8 : 80);
+        js_string_t haystack, needle;
+        uint32_t index;
+        int32_t expected;
+        bool found;
+        for(j = 0; j < needle_length; j++) {
+            needle_buff[j] = 'a' + random_below(alphabet);
+        }
+        haystack.buff = buff + sizeof(buff) - 128 - haystack_length;
+        haystack.length = haystack_length;
+        for(j = 0; j < haystack_length; j++) {
+            haystack.buff[j] = 'a' + random_below(alphabet);
+        }
+        // now and then plant the needle somewhere:
+        if(random_below(2) && needle_length <= haystack_length) {
+            memcpy(haystack.buff + random_below(haystack_length - needle_length + 1), needle_buff, needle_length);
+        }
+        memcpy(haystack.buff + haystack_length, needle_buff, needle_length);
+        needle.buff = needle_buff;
+        needle.length = needle_length;
+        expected = reference_index_of(haystack.buff, haystack_length, needle_buff, needle_length);
+        found = js_string_index_of(&haystack, &needle, &index);
+        if(found != (expected >= 0) || (found && (int32_t)index != expected)) {
+            if(failures++ < 10) {
+                printf("  \"%.*s\" in \"%.*s\": got %d, expected %d\n", (int)needle_length, needle_buff,
+                    (int)haystack_length, haystack.buff, found ? (int)index : -1, (int)expected);
+            }
+        }
+    }
+    printf("%-40s %8.2fms %u failures\n", "accuracy", elapsed(start), failures);
+}
+
+static char* text;
+
+static void search(char* name, bool (*index_of)(js_string_t*, js_string_t*, uint32_t*), char* needle_cstr, uint32_t repeat)
+{
+    js_string_t haystack, needle;
+    uint32_t i, index = 0, found = 0;
+    clock_t start;
+    haystack.buff = text;
+    haystack.length = TEXT_LENGTH;
+    needle.buff = needle_cstr;
+    needle.length = strlen(needle_cstr);
+    start = clock();
+    for(i = 0; i < repeat; i++) {
+        found += index_of(&haystack, &needle, &index);
+    }
+    printf("%-40s %8.2fms per MB (%s at %u)\n", name, elapsed(start) / repeat,
+        found ? "found" : "not found", found ? index : 0);
+}
+
+static void split(char* name, VAL (*split)(js_string_t*, js_string_t*), char* str, char* delimiter, uint32_t repeat)
+{
+    uint32_t i, j, pieces = 0;
+    double ms = 0;
+    clock_t start;
+    split_strings[0] = js_cstring(str);
+    split_strings[1] = js_cstring(delimiter);
+    for(i = 0; i < repeat; i += 1000) {
+        // collecting between batches keeps the heap small, and isn't timed:
+        js_gc_run();
+        js_gc_finish_sweep();
+        start = clock();
+        for(j = 0; j < 1000; j++) {
+            pieces += js_array_length(split(split_strings[0], split_strings[1]));
+        }
+        ms += elapsed(start);
+    }
+    printf("%-40s %8.2fus per split (%u pieces)\n", name, ms * 1000 / repeat, pieces / repeat);
+}
+
+static void realmain()
+{
+    static char* words[] = { "the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog ", "\n" };
+    char* path = "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin:/usr/games:/opt/bin:/home/user/bin";
+    char* file = "/home/user/projects/jsos/kernel/src/lib/fs/directory/entries/index.js";
+    char* tokens = "x = (a + b) * c - d / e + sqrt(f * f + g * g) - max(h, i, j) * 2.5 + 10 * (k - l)";
+    uint32_t i, length = 0;
+    
+    BENCH_ROOT(vm);
+    BENCH_ROOT(split_function);
+    BENCH_ROOT(split_strings);
+    vm = js_vm_new();
+    split_function = js_value_get_pointer(js_object_get(vm->lib.String_prototype, js_cstring("split")));
+    accuracy();
+    
+    // english-ish text, with the needles only near the end:
+    text = malloc(TEXT_LENGTH + 1);
+    while(length < TEXT_LENGTH) {
+        char* word = words[random_below(sizeof(words) / sizeof(words[0]))];
+        for(i = 0; word[i] && length < TEXT_LENGTH; i++) {
+            text[length++] = word[i];
+        }
+    }
+    memcpy(text + TEXT_LENGTH - 64, "#; the quick brown fox jumped over the lazy dog at last, again", 62);
+    text[TEXT_LENGTH] = 0;
+    
+    search("single byte, old", old_index_of, "#", 20);
+    search("single byte, new", js_string_index_of, "#", 20);
+    search("short needle, old", old_index_of, "fox jumped", 20);
+    search("short needle, new", js_string_index_of, "fox jumped", 20);
+    search("long needle, old", old_index_of, "the quick brown fox jumped over the lazy", 20);
+    search("long needle, new", js_string_index_of, "the quick brown fox jumped over the lazy", 20);
+    // almost matches everywhere, which is the worst case for the old search:
+    memset(text, 'a', TEXT_LENGTH);
+    search("periodic needle, old", old_index_of, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", 1);
+    search("periodic needle, new", js_string_index_of, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", 1);
+    
+    split("PATH on ':', old", old_split, path, ":", 20000);
+    split("PATH on ':', new", new_split, path, ":", 20000);
+    split("path on '/', old", old_split, file, "/", 20000);
+    split("path on '/', new", new_split, file, "/", 20000);
+    split("expression on ' ', old", old_split, tokens, " ", 20000);
+    split("expression on ' ', new", new_split, tokens, " ", 20000);
+    split("expression on ' * ', old", old_split, tokens, " * ", 20000);
+    split("expression on ' * ', new", new_split, tokens, " * ", 20000);
+}
+
+int main()
+{
+    uint32_t dummy;
+    js_gc_init(&dummy);
+    realmain();
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "gc.h"
+#include "st.h"
+#include "proptable.h"
+#include "object.h"
+#include "bench.h"
+
+/* compares st.c against the property table on the operations objects use */
+
+#define KEYS 50000
+/* every size does the same total number of operations */
+#define ROUNDS(count) (10 * KEYS / (count))
+
+static js_string_t** keys;
+
+static uint32_t hash_key(js_string_t* str)
+{
+    return js_string_hash(str);
+}
+
+static struct st_hash_type key_type = {
+    js_string_cmp,
+    (int(*)())hash_key
+};
+
+static int st_iter(st_data_t key, st_data_t record, st_data_t arg)
+{
+    *(uint32_t*)arg += 1;
+    return ST_CONTINUE;
+}
+
+static void bench_st(uint32_t count)
+{
+    st_table* table = NULL;
+    st_data_t value, key;
+    uint32_t i, r, found = 0, seen = 0;
+    clock_t start;
+    double insert = 0, lookup = 0, delete = 0, iterate = 0;
+    for(r = 0; r < ROUNDS(count); r++) {
+        start = clock();
+        table = st_init_table(&key_type);
+        for(i = 0; i < count; i++) {
+            st_insert(table, (st_data_t)keys[i], (st_data_t)keys[i]);
+        }
+        insert += elapsed(start);
+        start = clock();
+        for(i = 0; i < count; i++) {
+            found += st_lookup(table, (st_data_t)keys[(i * 7) % count], &value);
+        }
+        lookup += elapsed(start);
+        start = clock();
+        st_foreach(table, st_iter, (st_data_t)&seen);
+        iterate += elapsed(start);
+        start = clock();
+        for(i = 0; i < count; i += 2) {
+            key = (st_data_t)keys[i];
+            st_delete(table, &key, &value);
+        }
+        delete += elapsed(start);
+    }
+    printf("st.c       %6u keys: insert %7.2fms lookup %7.2fms iterate %6.2fms delete %7.2fms\n",
+        count, insert, lookup, iterate, delete);
+    if(found != ROUNDS(count) * count || seen != ROUNDS(count) * count) {
+        printf("  found %u and iterated over %u keys, expected %u\n", found, seen, ROUNDS(count) * count);
+    }
+}
+
+static void bench_proptable(uint32_t count)
+{
+    js_proptable_t* table = NULL;
+    js_string_t* key;
+    void* value;
+    uint32_t i, r, cursor, found = 0, seen = 0;
+    clock_t start;
+    double insert = 0, lookup = 0, delete = 0, iterate = 0;
+    for(r = 0; r < ROUNDS(count); r++) {
+        start = clock();
+        table = js_proptable_new();
+        for(i = 0; i < count; i++) {
+            js_proptable_insert(table, keys[i], keys[i]);
+        }
+        insert += elapsed(start);
+        start = clock();
+        for(i = 0; i < count; i++) {
+            found += js_proptable_lookup(table, keys[(i * 7) % count], &value);
+        }
+        lookup += elapsed(start);
+        start = clock();
+        cursor = 0;
+        while(js_proptable_next(table, &cursor, &key, &value)) {
+            seen++;
+        }
+        iterate += elapsed(start);
+        start = clock();
+        for(i = 0; i < count; i += 2) {
+            js_proptable_delete(table, keys[i]);
+        }
+        delete += elapsed(start);
+    }
+    printf("proptable  %6u keys: insert %7.2fms lookup %7.2fms iterate %6.2fms delete %7.2fms\n",
+        count, insert, lookup, iterate, delete);
+    if(found != ROUNDS(count) * count || seen != ROUNDS(count) * count) {
+        printf("  found %u and iterated over %u keys, expected %u\n", found, seen, ROUNDS(count) * count);
+    }
+}
+
+static void realmain()
+{
+    uint32_t i;
+    uint32_t sizes[] = { 8, 64, 1000, KEYS };
+    keys = js_alloc(sizeof(js_string_t*) * KEYS);
+    for(i = 0; i < KEYS; i++) {
+        keys[i] = js_string_format("property%u", i);
+    }
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_st(sizes[i]);
+        bench_proptable(sizes[i]);
+    }
+}
+
+int main()
+{
+    uint32_t dummy;
+    js_gc_init(&dummy);
+    realmain();
+    return 0;
+}